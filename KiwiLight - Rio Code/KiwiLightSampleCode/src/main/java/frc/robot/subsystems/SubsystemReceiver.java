@@ -13,7 +13,9 @@ import java.net.DatagramSocket;
 import java.net.SocketException;
 
 import edu.wpi.first.wpilibj.DriverStation;
+import edu.wpi.first.wpilibj.Timer;
 import edu.wpi.first.wpilibj.smartdashboard.SmartDashboard;
+import frc.robot.util.KiwiLightPacket;
 import frc.robot.util.Util;
 
 import edu.wpi.first.wpilibj2.command.SubsystemBase;
@@ -31,6 +33,13 @@ public class SubsystemReceiver extends SubsystemBase {
   private byte[]         receiveData;
 
   private long latestTime;
+  private double latestCaptureTimestamp;
+
+  private KiwiLightPacket latestPacket;
+  private long            lostPackets;
+  private long            latePackets;
+
+  private static final int MAX_LATE_PACKETS = 100; //how far behind a packet can be before the Pi is assumed to have restarted
 
 
   /**
@@ -40,6 +49,10 @@ public class SubsystemReceiver extends SubsystemBase {
     latestSegment = "-1,-1,-1,-1,-1,180,180";
     latestData = new double[] {-1, -1, -1, -1, -1, 180, 180};
     latestTime    = System.currentTimeMillis();
+    latestCaptureTimestamp = Timer.getFPGATimestamp();
+    latestPacket = null;
+    lostPackets = 0;
+    latePackets = 0;
 
     SmartDashboard.putString("RPi Data", latestSegment);
     SmartDashboard.putBoolean("Spotted", false);
@@ -62,18 +75,33 @@ public class SubsystemReceiver extends SubsystemBase {
       // D = Distance from target
       // HA = Horizontal Angle from center (positive = CW)
       // VA = Vertical Angle from center (positive = up)
+    // With target tracking on, the same seven fields follow again for where
+    // the target is predicted to be when the message is sent:
+    // :X,Y,W,H,D,HA,VA,PX,PY,PW,PH,PD,PHA,PVA;
+    // If the config sends the age of the frame, it comes last:
+    // :X,Y,W,H,D,HA,VA,AGE; or :X,Y,W,H,D,HA,VA,PX,PY,PW,PH,PD,PHA,PVA,AGE;
+      // AGE = Milliseconds from when the image was captured to when the message was sent
+    // Configs using the binary protocol send a KiwiLightPacket instead. The sent and
+    // predicted targets in it fill the same fields as the text message.
 
     Thread listener = new Thread(() -> {
       while(!Thread.interrupted()) {
         try {
           DatagramPacket receivePacket = new DatagramPacket(receiveData, receiveData.length); //create a new packet for the receiving data 
           serverSocket.receive(receivePacket); //receive the packet from the Socket
-          String segment = new String(receivePacket.getData()).replaceAll("\\s+",""); //remove whitespace and place data in 'segment'
+          double receiveTimestamp = Timer.getFPGATimestamp();
+          if(KiwiLightPacket.isPacket(receivePacket.getData(), receivePacket.getLength())) {
+            receiveBinary(receivePacket, receiveTimestamp);
+            continue;
+          }
+
+          String segment = new String(receivePacket.getData(), 0, receivePacket.getLength()).replaceAll("\\s+",""); //remove whitespace and place data in 'segment'
           latestSegment = segment.substring(segment.indexOf(":") + 1, segment.indexOf(";")); // store segment without borders
           latestTime = System.currentTimeMillis(); // add timestamp for stored segment
           String formattedString = segment.substring(segment.indexOf(":") + 1, segment.indexOf(";"));
           SmartDashboard.putString("RPi Data", formattedString); // put string on dashboard without borders
           latestData = analyzeData(formattedString);
+          latestCaptureTimestamp = receiveTimestamp - (analyzeAge(formattedString) / 1000.0);
 
         } catch (IOException e) { //thrown when the socket cannot receive the packet
           DriverStation.reportError("IO EXCEPTION", true);
@@ -147,6 +175,65 @@ public class SubsystemReceiver extends SubsystemBase {
     return latestData[6];
   }
 
+  /**
+   * Returns the horizontal angle (degrees) to where the target is predicted to be
+   * when the message was sent. Same as getHorizontalAngleToTarget() if the Pi is 
+   * not tracking targets.
+   */
+  public double getPredictedHorizontalAngleToTarget() {
+    return (latestData.length > 7 ? latestData[12] : latestData[5]);
+  }
+
+  /**
+   * Returns the vertical angle (degrees) to where the target is predicted to be
+   * when the message was sent. Same as getVerticalAngleToTarget() if the Pi is 
+   * not tracking targets.
+   */
+  public double getPredictedVerticalAngleToTarget() {
+    return (latestData.length > 7 ? latestData[13] : latestData[6]);
+  }
+
+  /**
+   * Returns the distance to where the target is predicted to be when the message
+   * was sent. Same as getDistanceToTarget() if the Pi is not tracking targets.
+   */
+  public double getPredictedDistanceToTarget() {
+    return (latestData.length > 7 ? latestData[11] : latestData[4]);
+  }
+
+  /**
+   * Returns the FPGA time (seconds, like Timer.getFPGATimestamp()) at which the image
+   * behind the latest data was captured. Look up the robot's pose at this time to
+   * make up for vision latency. If the Pi does not send the age of its frames, this
+   * is when the data was received.
+   */
+  public double getCaptureTimestamp() {
+    return latestCaptureTimestamp;
+  }
+
+  /**
+   * Returns every target in the latest binary packet, or an empty array if the Pi
+   * sends text messages. See KiwiLightPacket for the flags that say which is which.
+   */
+  public KiwiLightPacket.Target[] getTargets() {
+    KiwiLightPacket packet = latestPacket;
+    return (packet == null ? new KiwiLightPacket.Target[0] : packet.targets);
+  }
+
+  /**
+   * Returns the number of binary packets that never arrived, going by their sequence numbers.
+   */
+  public long getLostPackets() {
+    return lostPackets;
+  }
+
+  /**
+   * Returns the number of binary packets that arrived after a newer one and were ignored.
+   */
+  public long getLatePackets() {
+    return latePackets;
+  }
+
   /**
    * Returns true if a target is seen, false otherwise.
    */
@@ -192,13 +279,24 @@ public class SubsystemReceiver extends SubsystemBase {
     double[] newData = {-1, -1, -1, -1, -1, 180, 180};
     String[] stringData = input.split(",");
 
-    if(stringData.length != newData.length) {
+    //the age of the frame is not part of the data
+    int fields = stringData.length;
+    if(hasAge(fields)) {
+      fields--;
+    }
+
+    //tracked messages carry the predicted fields too
+    if(fields == newData.length * 2) {
+      newData = new double[] {-1, -1, -1, -1, -1, 180, 180, -1, -1, -1, -1, -1, 180, 180};
+    }
+
+    if(fields != newData.length) {
       DriverStation.reportWarning("INPUT STRING IMPROPERLY FORMATTED!", true);
       return newData;
     }
 
     try {
-      for(int i=0; i<stringData.length; i++) {
+      for(int i=0; i<fields; i++) {
         newData[i] = Integer.parseInt(stringData[i]);
       }
     } catch(Exception ex) {
@@ -207,4 +305,99 @@ public class SubsystemReceiver extends SubsystemBase {
 
     return newData;
   }
+
+  /**
+   * Reads a binary packet from the Pi into the latest data.
+   * @param receivePacket The received datagram.
+   * @param receiveTimestamp The FPGA time at which it was received.
+   */
+  private void receiveBinary(DatagramPacket receivePacket, double receiveTimestamp) {
+    KiwiLightPacket packet = KiwiLightPacket.decode(receivePacket.getData(), receivePacket.getLength());
+    if(packet == null) {
+      DriverStation.reportWarning("BINARY PACKET IMPROPERLY FORMATTED!", true);
+      return;
+    }
+
+    //packets can arrive out of order; an old one would only move the target backwards.
+    //one far older than the last is from a Pi that restarted, so it starts the count over
+    int gap = (latestPacket == null ? 1 : (int) (packet.sequence - latestPacket.sequence));
+    if(gap <= 0 && gap > -MAX_LATE_PACKETS) {
+      latePackets++;
+      return;
+    }
+
+    if(gap > 1) {
+      lostPackets += gap - 1;
+    }
+
+    latestPacket = packet;
+    latestTime = System.currentTimeMillis();
+    latestData = analyzePacket(packet);
+    latestCaptureTimestamp = receiveTimestamp - (packet.latency / 1000000.0);
+    latestSegment = "";
+    for(int i=0; i<latestData.length; i++) {
+      latestSegment += (i > 0 ? "," : "") + (int) latestData[i];
+    }
+
+    SmartDashboard.putString("RPi Data", latestSegment);
+  }
+
+  /**
+   * Lays out the sent and predicted targets of a packet the same way analyzeData() lays out a text message.
+   */
+  private double[] analyzePacket(KiwiLightPacket packet) {
+    KiwiLightPacket.Target sent = packet.findTarget(KiwiLightPacket.SENT);
+    KiwiLightPacket.Target predicted = packet.findTarget(KiwiLightPacket.PREDICTED);
+    double[] newData = new double[predicted == null ? 7 : 14];
+    putTarget(newData, 0, sent);
+    if(predicted != null) {
+      putTarget(newData, 7, predicted);
+    }
+
+    return newData;
+  }
+
+  /**
+   * Puts the seven message fields of "target" into "data" starting at "at". A null target is put as not seen.
+   */
+  private void putTarget(double[] data, int at, KiwiLightPacket.Target target) {
+    if(target == null) {
+      double[] notSeen = {-1, -1, -1, -1, -1, 180, 180};
+      System.arraycopy(notSeen, 0, data, at, notSeen.length);
+      return;
+    }
+
+    data[at]     = target.x;
+    data[at + 1] = target.y;
+    data[at + 2] = target.width;
+    data[at + 3] = target.height;
+    data[at + 4] = target.distance;
+    data[at + 5] = target.horizontalAngle;
+    data[at + 6] = target.verticalAngle;
+  }
+
+  /**
+   * Returns the age (in milliseconds) of the frame that a message was made from,
+   * or 0 if the message does not say.
+   */
+  private double analyzeAge(String input) {
+    String[] stringData = input.split(",");
+    if(!hasAge(stringData.length)) {
+      return 0;
+    }
+
+    try {
+      return Integer.parseInt(stringData[stringData.length - 1]);
+    } catch(Exception ex) {
+      DriverStation.reportWarning("PARSING AGE ERROR: " + ex.getMessage(), true);
+      return 0;
+    }
+  }
+
+  /**
+   * Returns true if a message with the given number of fields ends with the age of its frame.
+   */
+  private boolean hasAge(int fields) {
+    return fields == 8 || fields == 15;
+  }
 }
\ No newline at end of file
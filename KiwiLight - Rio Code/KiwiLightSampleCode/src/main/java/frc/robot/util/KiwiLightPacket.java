@@ -0,0 +1,114 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) 2019 FIRST. All Rights Reserved.                             */
+/* Open Source Software - may be modified and shared by FRC teams. The code   */
+/* must be accompanied by the FIRST BSD license file in the root directory of */
+/* the project.                                                               */
+/*----------------------------------------------------------------------------*/
+
+package frc.robot.util;
+
+import java.nio.ByteBuffer;
+
+/**
+ * A binary packet from the Pi, sent when a config uses the binary protocol.
+ * Mirrors the TargetPacket class in the vision code. Every number is big-endian.
+ *
+ * Header: magic (2), version (1), header size (1), sequence (4), capture timestamp
+ * in microseconds (8), capture-to-send latency in microseconds (4), number of
+ * targets (1), size of each target (1), reserved (2)
+ * Each target: id (2), flags (1), reserved (1), then x, y, width, height, distance,
+ * horizontal angle, vertical angle, and fit as floats
+ */
+public class KiwiLightPacket {
+  public static final int MAGIC       = 0x4B4C; //"KL"
+  public static final int VERSION     = 1;
+  public static final int HEADER_SIZE = 24;
+  public static final int TARGET_SIZE = 36;
+
+  //target flags
+  public static final int SENT      = 1; //the target the text message would describe
+  public static final int PREDICTED = 2; //where the sent target should be when the packet was sent
+  public static final int TRACKED   = 4; //an estimate from tracking, not a target seen in the frame
+
+  /**
+   * One target in a packet. Positions and sizes are in pixels, angles in degrees.
+   */
+  public static class Target {
+    public int id, flags;
+    public float x, y, width, height, distance, horizontalAngle, verticalAngle, fit;
+
+    public boolean hasFlag(int flag) {
+      return (flags & flag) != 0;
+    }
+  }
+
+  public long     sequence;
+  public long     timestamp; //microseconds, on the Pi's clock
+  public long     latency;   //microseconds from capture to send
+  public Target[] targets;
+
+  /**
+   * Reads a packet. Packets from later versions are read as far as this version understands them.
+   * @param data The received bytes.
+   * @param length The number of bytes received.
+   * @return The packet, or null if the bytes are not a KiwiLight packet or are cut short.
+   */
+  public static KiwiLightPacket decode(byte[] data, int length) {
+    if(!isPacket(data, length)) {
+      return null;
+    }
+
+    ByteBuffer buffer = ByteBuffer.wrap(data, 0, length);
+    int version = buffer.get(2) & 0xFF;
+    int headerSize = buffer.get(3) & 0xFF;
+    int numberOfTargets = buffer.get(20) & 0xFF;
+    int targetSize = buffer.get(21) & 0xFF;
+    if(version < VERSION || headerSize < HEADER_SIZE || targetSize < TARGET_SIZE || length < headerSize + (numberOfTargets * targetSize)) {
+      return null;
+    }
+
+    KiwiLightPacket packet = new KiwiLightPacket();
+    packet.sequence = buffer.getInt(4) & 0xFFFFFFFFL;
+    packet.timestamp = buffer.getLong(8);
+    packet.latency = buffer.getInt(16) & 0xFFFFFFFFL;
+    packet.targets = new Target[numberOfTargets];
+
+    for(int i=0; i<numberOfTargets; i++) {
+      int at = headerSize + (i * targetSize);
+      Target target = new Target();
+      target.id = buffer.getShort(at);
+      target.flags = buffer.get(at + 2) & 0xFF;
+      target.x = buffer.getFloat(at + 4);
+      target.y = buffer.getFloat(at + 8);
+      target.width = buffer.getFloat(at + 12);
+      target.height = buffer.getFloat(at + 16);
+      target.distance = buffer.getFloat(at + 20);
+      target.horizontalAngle = buffer.getFloat(at + 24);
+      target.verticalAngle = buffer.getFloat(at + 28);
+      target.fit = buffer.getFloat(at + 32);
+      packet.targets[i] = target;
+    }
+
+    return packet;
+  }
+
+  /**
+   * Returns true if the bytes start like a KiwiLight packet, false if they are probably a text message.
+   */
+  public static boolean isPacket(byte[] data, int length) {
+    return length >= HEADER_SIZE && (((data[0] & 0xFF) << 8) | (data[1] & 0xFF)) == MAGIC;
+  }
+
+  /**
+   * Returns the first target with the given flag, or null if there is none.
+   */
+  public Target findTarget(int flag) {
+    for(int i=0; i<targets.length; i++) {
+      if(targets[i].hasFlag(flag)) {
+        return targets[i];
+      }
+    }
+
+    return null;
+  }
+}
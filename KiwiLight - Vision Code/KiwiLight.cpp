@@ -10,7 +10,10 @@ using namespace KiwiLight;
 
 //define some static vars for KiwiLightApp. Vars will be defined for real on call to Create();
 VideoCapture KiwiLightApp::camera;
+FrameGrabber KiwiLightApp::grabber;
 UDP          KiwiLightApp::udpSender;
+std::shared_ptr<UDPPublisher> KiwiLightApp::udpPublisher;
+std::vector<UDPDestination> KiwiLightApp::extraUDPDestinations;
 Runner       KiwiLightApp::runner;
 ConfigEditor KiwiLightApp::configeditor;
 CronWindow   KiwiLightApp::cronWindow;
@@ -21,10 +24,12 @@ AppMode      KiwiLightApp::mode = AppMode::UI_STREAM;
 bool         KiwiLightApp::lastImageGrabSuccessful = false;
 bool         KiwiLightApp::udpEnabled = true;
 bool         KiwiLightApp::streamThreadEnabled = true; //acts as a kind of "enable switch" for the streamthread because it seems to like starting when its not supposed to
-bool         KiwiLightApp::lfgImgInUse = false;
 bool         KiwiLightApp::uiInitalized = false;
-Mat          KiwiLightApp::lastFrameGrabImage;
 Mat          KiwiLightApp::defaultOutImage;
+FrameRing    KiwiLightApp::displayRing;
+long         KiwiLightApp::lastDisplayedSequence = 0;
+long         KiwiLightApp::framesTakenDirectly = 0;
+long long    KiwiLightApp::lastImageTimestamp = 0;
 Window       KiwiLightApp::win;
 UDPPanel     KiwiLightApp::udpPanel;
 ConfigPanel  KiwiLightApp::confInfo;
@@ -179,12 +184,16 @@ ConfigEditor KiwiLightApp::GetEditor() { return configeditor; }
 bool KiwiLightApp::UIInitalized() { return uiInitalized; }
 
 /**
- * Takes an image with the KiwiLight camera and returns it
+ * Takes an image with the KiwiLight camera and returns it.
+ * If the capture thread is running, the newest frame it captured is returned instead.
  */
 Mat KiwiLightApp::TakeImage() {
     Mat img;
-    if(KiwiLightApp::camera.isOpened()) {
+    if(KiwiLightApp::grabber.Running()) {
+        KiwiLightApp::lastImageGrabSuccessful = KiwiLightApp::grabber.Latest(img);
+    } else if(KiwiLightApp::camera.isOpened()) {
         bool success = KiwiLightApp::camera.grab();
+        KiwiLightApp::lastImageTimestamp = Clock::GetMonotonicTime(); //grab() returns right after the camera hands over the frame
         
         if(success) {
             success = KiwiLightApp::camera.retrieve(img);
@@ -200,6 +209,33 @@ Mat KiwiLightApp::TakeImage() {
     return img;
 }
 
+/**
+ * Takes an image from the camera that may be shared by several Runners. While the capture thread 
+ * is running, callers asking for a frame after the same id all get the same image.
+ * @param afterId The id of the last frame the caller processed.
+ */
+SharedFrame KiwiLightApp::TakeSharedFrame(long afterId) {
+    if(KiwiLightApp::grabber.Running()) {
+        SharedFrame frame = KiwiLightApp::grabber.Shared(afterId);
+        KiwiLightApp::lastImageGrabSuccessful = frame.Valid();
+        return frame;
+    }
+
+    Mat img = TakeImage();
+    if(img.empty()) {
+        return SharedFrame();
+    }
+
+    return SharedFrame(++KiwiLightApp::framesTakenDirectly, img, KiwiLightApp::lastImageTimestamp);
+}
+
+/**
+ * Returns a summary of the capture thread's frame counters.
+ */
+std::string KiwiLightApp::GetCaptureSummary() {
+    return KiwiLightApp::grabber.Summary();
+}
+
 /**
  * Returns the value of KiwiLight's camera's property on the given ID (ID from opencv constants).
  */
@@ -221,6 +257,21 @@ void KiwiLightApp::SetCameraProperty(int propId, double value) {
     KiwiLightApp::camera.set(propId, value);
 }
 
+/**
+ * Starts grabbing frames from KiwiLight's camera on a separate thread. Until StopCaptureThread() is called,
+ * TakeImage() returns the newest grabbed frame instead of waiting on the camera.
+ */
+void KiwiLightApp::StartCaptureThread() {
+    KiwiLightApp::grabber.Start(&KiwiLightApp::camera);
+}
+
+/**
+ * Stops the capture thread. TakeImage() will read from the camera directly again.
+ */
+void KiwiLightApp::StopCaptureThread() {
+    KiwiLightApp::grabber.Stop();
+}
+
 /**
  * Returns true if last image take was successful, false otherwise.
  */
@@ -242,6 +293,13 @@ UDP KiwiLightApp::GetUDP() {
     return KiwiLightApp::udpSender;
 }
 
+/**
+ * Returns the publisher used when a config sends to more than one destination, or null if it only sends to one.
+ */
+std::shared_ptr<UDPPublisher> KiwiLightApp::GetUDPPublisher() {
+    return std::atomic_load(&KiwiLightApp::udpPublisher);
+}
+
 /**
  * Returns true if the UDP sender is enabled, false otherwise.
  */
@@ -384,7 +442,14 @@ void KiwiLightApp::OpenNewCameraOnIndex(int index) {
     if(KiwiLightApp::currentCameraIndex != index || !KiwiLightApp::camera.isOpened()) {
         KiwiLightApp::currentCameraIndex = index;
         AppMode currentMode = KiwiLightApp::mode;
+
+        //the capture thread must not be reading from the camera while it is replaced
+        bool grabberWasRunning = KiwiLightApp::grabber.Running();
+        KiwiLightApp::grabber.Stop();
         KiwiLightApp::camera = VideoCapture(index);
+        if(grabberWasRunning) {
+            KiwiLightApp::grabber.Start(&KiwiLightApp::camera);
+        }
         
         //set the auto exposure menu in shell because opencv cant do it
         //if this is not set then exposure cannot be set
@@ -436,6 +501,7 @@ void KiwiLightApp::ReconnectUDP(std::string newAddress, int newPort) {
  */
 void KiwiLightApp::ReconnectUDP(std::string newAddress, int newPort, bool block) {
     KiwiLightApp::udpSender = UDP(newAddress, newPort, block);
+    KiwiLightApp::RebuildUDPPublisher();
     if(KiwiLightApp::uiInitalized) {
         udpPanel.SetAddress(udpSender.GetAddress());
         udpPanel.SetPort(udpSender.GetPort());
@@ -444,10 +510,47 @@ void KiwiLightApp::ReconnectUDP(std::string newAddress, int newPort, bool block)
 }
 
 /**
- * Sends "message" over KiwiLight's socket sender.
+ * Sends "message" over KiwiLight's socket sender, and to the extra destinations of the config if it has any.
+ */
+void KiwiLightApp::SendOverUDP(const std::string &message) {
+    //the publisher can be replaced on the UI thread while this runs, so this holds on to the one it sends with
+    std::shared_ptr<UDPPublisher> publisher = std::atomic_load(&KiwiLightApp::udpPublisher);
+    if(publisher) {
+        publisher->Publish(message);
+    } else {
+        KiwiLightApp::udpSender.Send(message);
+    }
+}
+
+/**
+ * Sets the places, besides the address and port of the socket sender, that every message is sent to.
+ * Pass an empty vector to only send to the socket sender.
  */
-void KiwiLightApp::SendOverUDP(std::string message) {
-    KiwiLightApp::udpSender.Send(message);
+void KiwiLightApp::SetExtraUDPDestinations(std::vector<UDPDestination> destinations) {
+    KiwiLightApp::extraUDPDestinations = destinations;
+    KiwiLightApp::RebuildUDPPublisher();
+}
+
+/**
+ * Builds a new publisher for the socket sender's destination followed by the extra destinations, and swaps it in.
+ * The stream thread may be sending with the old one, so it is never changed; it is freed once that send is done.
+ * There is no publisher when there are no extra destinations, because the socket sender is used instead.
+ */
+void KiwiLightApp::RebuildUDPPublisher() {
+    std::shared_ptr<UDPPublisher> newPublisher;
+    if(KiwiLightApp::extraUDPDestinations.size() > 0) {
+        newPublisher = std::make_shared<UDPPublisher>();
+        newPublisher->AddDestination(udpSender.GetAddress(), udpSender.GetPort());
+        newPublisher->SetMulticastInterfaceFor(udpSender.GetAddress(), udpSender.GetPort());
+        for(int i=0; i<KiwiLightApp::extraUDPDestinations.size(); i++) {
+            UDPDestination destination = KiwiLightApp::extraUDPDestinations[i];
+            if(!newPublisher->AddDestination(destination.address, destination.port)) {
+                std::cout << "WARNING: UDP destination \"" << destination.address << "\" is not an IPv4 address and will not be sent to." << std::endl;
+            }
+        }
+    }
+
+    std::atomic_store(&KiwiLightApp::udpPublisher, newPublisher);
 }
 
 /**
@@ -507,18 +610,20 @@ void KiwiLightApp::UpdateApp() {
         if(KiwiLightApp::mode != AppMode::UI_HEADLESS) {
             //update the camera error label based on how successful thread is being
             if(lastImageGrabSuccessful) {
-                //wait for the output image to be updated by other thread
-                while(KiwiLightApp::lfgImgInUse) {
-                    usleep(100);
+                //take the newest frame from the stream thread, and only redraw if it is one we haven't shown yet
+                Mat newestFrame;
+                KiwiLightApp::displayRing.Acquire(newestFrame);
+                long newestSequence = KiwiLightApp::displayRing.Sequence();
+                if(newestSequence != KiwiLightApp::lastDisplayedSequence) {
+                    KiwiLightApp::outputImage.Update(newestFrame);
+                    KiwiLightApp::lastDisplayedSequence = newestSequence;
                 }
-                KiwiLightApp::lfgImgInUse = true;
-                KiwiLightApp::outputImage.Update(KiwiLightApp::lastFrameGrabImage);
-                KiwiLightApp::lfgImgInUse = false;
                 KiwiLightApp::cameraStatusLabel.SetText(""); 
             } else {
                 KiwiLightApp::cameraStatusLabel.SetText("Camera Error!");
                 KiwiLightApp::cameraFailures++;
                 KiwiLightApp::outputImage.Update(KiwiLightApp::defaultOutImage);
+                KiwiLightApp::lastDisplayedSequence = -1; //make sure the next good frame replaces the default image
 
                 if(KiwiLightApp::cameraFailures > 50) {
                     //attempt to reconnect the camera stream
@@ -581,7 +686,7 @@ void KiwiLightApp::UpdateStreams() {
                     
                     //if the udp is enabled, send the message
                     if(KiwiLightApp::udpEnabled) {
-                        KiwiLightApp::udpSender.Send(output);
+                        KiwiLightApp::SendOverUDP(KiwiLightApp::runner.GetLastFramePacket());
                     }
                 }
                 break;
@@ -589,11 +694,9 @@ void KiwiLightApp::UpdateStreams() {
                     KiwiLightApp::configeditor.UpdateImageOnly(); //boolean
                     displayImage = KiwiLightApp::configeditor.GetOutputImage();
                     
-                    std::string output = KiwiLightApp::configeditor.GetLastFrameResult(); //gets the results of the last runner iteration
-                    
-                    //send if udp enabled
+                    //send the results of the last runner iteration if udp enabled
                     if(KiwiLightApp::udpEnabled) {
-                        KiwiLightApp::udpSender.Send(output);
+                        KiwiLightApp::SendOverUDP(KiwiLightApp::configeditor.GetLastFramePacket());
                     }
                 }
                 break;
@@ -603,15 +706,10 @@ void KiwiLightApp::UpdateStreams() {
             }
             break;
         }
-        // if successful, update the display image
-        if(KiwiLightApp::lastImageGrabSuccessful) {            
-            //wait for out image to be used by other thread
-            while(KiwiLightApp::lfgImgInUse) {
-                usleep(10);
-            }
-            KiwiLightApp::lfgImgInUse = true;
-            KiwiLightApp::lastFrameGrabImage = displayImage;
-            KiwiLightApp::lfgImgInUse = false;
+        // if successful, hand the display image to the UI thread. This never waits on the UI.
+        if(KiwiLightApp::lastImageGrabSuccessful && !displayImage.empty()) {
+            displayImage.copyTo(KiwiLightApp::displayRing.WriteBuffer());
+            KiwiLightApp::displayRing.Publish(Clock::GetMonotonicTime());
         }
     } catch(cv::Exception ex) {
         std::cout << "An OpenCv Exception was encountered while running the Streaming thread!" << std::endl;
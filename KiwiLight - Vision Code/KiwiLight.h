@@ -48,16 +48,21 @@ namespace KiwiLight {
 
         //camera accessors
         static Mat TakeImage();
+        static SharedFrame TakeSharedFrame(long afterId);
+        static std::string GetCaptureSummary();
         static double GetCameraProperty(int propId);
         static bool CameraOpen();
 
         //camera mutators
         static void SetCameraProperty(int propId, double value);
+        static void StartCaptureThread();
+        static void StopCaptureThread();
 
         //general accessors 
         static bool LastImageCaptureSuccessful();
         static AppMode CurrentMode();
         static UDP GetUDP();
+        static std::shared_ptr<UDPPublisher> GetUDPPublisher();
         static bool GetUDPEnabled();
         static std::string GetCurrentFile();
 
@@ -78,7 +83,8 @@ namespace KiwiLight {
         static void OpenNewCameraOnIndex(int index);
         static void ReconnectUDP(std::string newAddress, int newPort);
         static void ReconnectUDP(std::string newAddress, int newPort, bool block);
-        static void SendOverUDP(std::string message);
+        static void SendOverUDP(const std::string &message);
+        static void SetExtraUDPDestinations(std::vector<UDPDestination> destinations);
 
         //thread utilities
         static void LaunchStreamingThread(AppMode newMode);
@@ -112,6 +118,7 @@ namespace KiwiLight {
         static void RunHeadlessly();
         static void StopRunningHeadlessly();
         static void RunHeadlesslyCallback();
+        static void RebuildUDPPublisher();
         static void ShowLog(XMLDocument log);
         static void ShowLog();
         static void ShowAboutWindow();
@@ -124,7 +131,10 @@ namespace KiwiLight {
         static Logger logger;
         static LogViewer logViewer;
         static VideoCapture camera;
+        static FrameGrabber grabber;
         static UDP udpSender;
+        static std::shared_ptr<UDPPublisher> udpPublisher; //null without extra destinations. Only replaced with std::atomic_store()
+        static std::vector<UDPDestination> extraUDPDestinations;
         static GThread 
             *streamingThread;
 
@@ -134,11 +144,12 @@ namespace KiwiLight {
             lastImageGrabSuccessful,
             udpEnabled,
             streamThreadEnabled,
-            lfgImgInUse,
             uiInitalized;
-        static Mat 
-            lastFrameGrabImage,
-            defaultOutImage;
+        static Mat defaultOutImage;
+        static FrameRing displayRing;
+        static long lastDisplayedSequence;
+        static long framesTakenDirectly;
+        static long long lastImageTimestamp; //when the last image taken without the capture thread was grabbed
         static int currentCameraIndex;
 
         //ui widgets
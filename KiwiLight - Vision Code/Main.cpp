@@ -7,18 +7,64 @@
 using namespace cv;
 using namespace KiwiLight;
 
+//queue depth of the pipelined runner, or 0 to run each config's stages one after another. Set with "-p".
+int pipelineDepth = 0;
+
+//file to record raw frames to, or "" to not record. Set with "-r".
+std::string recordingFile = "";
+
+//how often (in milliseconds) the headless runner prints its timing summaries
+const int SUMMARY_INTERVAL = 10000;
+
+//number of frames the color kernel benchmark takes from a live camera
+const int BENCHMARK_CAMERA_FRAMES = 300;
+
+//number of synthetic frames the target matcher benchmark times, and how many of them are also checked against every combination
+const int MATCHER_BENCHMARK_FRAMES = 200;
+const int MATCHER_CHECKED_FRAMES = 5;
+
+//number of times each search runs per frame when the searches built for fixed sizes are timed against the generic one
+const int MATCHER_BENCHMARK_RUNS = 10;
+
+//number of contours in each frame of the target matcher benchmark. Set with "-m".
+int matcherBenchmarkContours = 60;
+
+//number of messages the output benchmark builds each way. Set with "-o".
+int outputBenchmarkMessages = 100000;
+
+//number of fields in the messages the output benchmark builds, the same as a message without tracking or age
+const int OUTPUT_BENCHMARK_FIELDS = 7;
+
 /**
  * Displays the KiwiLight help message.
  */
 void ShowHelp() {
     std::cout << "KIWILIGHT HELP\n";
-    std::cout << "Usage: KiwiLight [-h] [-c] [config files]\n";
+    std::cout << "Usage: KiwiLight [-h] [-c] [-p [depth]] [-s source] [-r file] [-k kernel] [-b] [-m [contours]] [-o [messages]] [config files]\n";
     std::cout << "\n";
     std::cout << "KiwiLight is a smart vision solution for FRC applications developed by FRC Team 3695: Foximus Prime.\n";
     std::cout << "\n";
     std::cout << "Options:\n";
     std::cout << "-c: Runs a config file, or multiple config files.\n";
     std::cout << "-h: Displays this help window.\n";
+    std::cout << "-p: Used with -c. Runs the stages of each config on separate threads, with [depth] frames (default " << RunnerPipeline::DEFAULT_QUEUE_DEPTH << ") allowed to wait between stages.\n";
+    std::cout << "    Raises the frame rate on multi-core machines, at the cost of up to one frame of extra latency.\n";
+    std::cout << "-s: Used with -c. Sets where frames come from. [source] is one of:\n";
+    std::cout << "    camera              The camera (default).\n";
+    std::cout << "    video:<file>        A video file. KiwiLight stops at the end of the video.\n";
+    std::cout << "    images:<directory>  The images in a directory, in file name order. A single image file works too.\n";
+    std::cout << "    raw:<file>          A recording made with -r.\n";
+    std::cout << "    Files are read as fast as they can be processed.\n";
+    std::cout << "-r: Used with -c. Records every frame to [file] (appending a new session if it exists) so it can be replayed with \"-s raw:[file]\".\n";
+    std::cout << "    Frames are written in the background and dropped from the recording if the disk can't keep up.\n";
+    std::cout << "-k: Chooses how the preprocessor classifies pixel colors. [kernel] is one of auto (default), scalar, ssse3, avx2, or neon.\n";
+    std::cout << "-b: Benchmarks every color kernel this CPU supports against OpenCV's color conversion, using the color of the\n";
+    std::cout << "    first config file and frames from -s, and checks that they all produce the same masks.\n";
+    std::cout << "-m: Benchmarks the target matcher on synthetic frames of [contours] (default 60) strips of tape, looking for a\n";
+    std::cout << "    three-strip target, and checks the targets it finds against testing every combination of three strips.\n";
+    std::cout << "    Then times the searches built for targets of one, two, and three contours against the generic search.\n";
+    std::cout << "-o: Benchmarks building [messages] (default " << outputBenchmarkMessages << ") messages for the RIO with std::to_string() against a MessageWriter,\n";
+    std::cout << "    first alone and then while sending each one to 127.0.0.1:3695, and checks that both build the same messages.\n";
     std::cout << std::endl;
 }
 
@@ -35,6 +81,10 @@ void RunConfigs(std::vector<std::string> filePaths) {
     std::cout << "Config files found: " << filePaths.size() << "\n";
     std::cout << "Ensure that all config files share the same UDP Address and Port." << std::endl;
     
+    //the source is chosen first, so replays don't open the camera to apply the configs' camera settings
+    std::shared_ptr<FrameSource> frameSource = Runner::GetFrameSource();
+    bool usingCamera = frameSource->Live();
+
     //initalize the runners
     std::cout << "\nInitalizing Runners" << std::endl;
     const int numTargets = (const int) filePaths.size();
@@ -44,7 +94,7 @@ void RunConfigs(std::vector<std::string> filePaths) {
         runnerFiles = "";
     int totalContours = 0;
     for(int i=0; i<filePaths.size(); i++) {
-        runners[i] = Runner(filePaths[i], false);
+        runners[i] = Runner(filePaths[i], false, usingCamera);
         totalContours += runners[i].NumberOfContours();
 
         runnerNames += runners[i].GetConfName();
@@ -79,64 +129,555 @@ void RunConfigs(std::vector<std::string> filePaths) {
     std::cout << " Contours:    " << totalContours << std::endl;
     std::cout << " UDP Address: " << KiwiLightApp::GetUDP().GetAddress() << std::endl;
     std::cout << " UDP Port:    " << KiwiLightApp::GetUDP().GetPort() << std::endl;
+    std::shared_ptr<UDPPublisher> publisher = KiwiLightApp::GetUDPPublisher();
+    for(int i=1; publisher && i<publisher->NumberOfDestinations(); i++) {
+        UDPDestination destination = publisher->GetDestination(i);
+        std::cout << " Also to:     " << destination.address << ":" << destination.port << (destination.multicast ? " (multicast)" : "") << std::endl;
+    }
     std::cout << "                                            " << std::endl;
     std::cout << "--------------------------------------------" << std::endl;
 
+    //grab frames on a separate thread so that capturing overlaps with processing
+    std::cout << "Frame source: " << frameSource->Describe() << std::endl;
+    std::shared_ptr<FrameRecorder> recorder;
+    if(recordingFile != "") {
+        std::cout << "Recording frames to " << recordingFile << std::endl;
+        recorder = std::shared_ptr<FrameRecorder>(new FrameRecorder(frameSource, recordingFile, FrameRecorder::DEFAULT_QUEUE_DEPTH));
+        frameSource = recorder;
+        Runner::SetFrameSource(recorder);
+    }
+    if(usingCamera) {
+        KiwiLightApp::StartCaptureThread();
+    }
+
+    //in pipelined mode, each runner's stages get their own threads. Otherwise, the runners share each frame on a thread pool
+    std::vector< std::unique_ptr<RunnerPipeline> > pipelines;
+    std::unique_ptr<ConfigExecutor> executor;
+    if(pipelineDepth > 0) {
+        std::cout << "Running pipelined with a queue depth of " << pipelineDepth << std::endl;
+
+        //every pipeline takes its frames from the source itself. Replays hand each of them every frame, 
+        //so the configs are compared on the same frames no matter how fast each one runs
+        frameSource->SetConsumers(numTargets);
+        for(int i=0; i<numTargets; i++) {
+            pipelines.push_back(std::unique_ptr<RunnerPipeline>(new RunnerPipeline(&runners[i], pipelineDepth)));
+            pipelines[i]->Start();
+        }
+    } else {
+        executor = std::unique_ptr<ConfigExecutor>(new ConfigExecutor(runners, numTargets));
+    }
+
+    Clock summaryClock = Clock();
+    summaryClock.Start();
+
+    //the results are copied into the same strings every frame, so their memory is reused
+    std::vector<std::string> results = std::vector<std::string>(numTargets, Runner::NULL_MESSAGE);
     while(KiwiLightApp::CurrentMode() == AppMode::UI_HEADLESS) {
-        Target closestTarget;
+        int closestRunner = -1;
+        double closestTargetObliqueAngle = 360;
+
+        if(pipelineDepth > 0) {
+            //once the source runs out, the frames still in the pipelines are finished and sent before stopping
+            bool drained = true;
+            for(int i=0; i<numTargets; i++) {
+                results[i] = pipelines[i]->Next();
+                drained = drained && pipelines[i]->Drained();
+            }
+
+            if(drained) {
+                break;
+            }
+        } else {
+            if(frameSource->Finished()) {
+                break;
+            }
 
-        double 
-            closestTargetHorizontalAngle = 360,
-            closestTargetVerticalAngle = 360,
-            closestTargetObliqueAngle = 360;
-        
-        bool targetFound = false;
+            results = executor->Iterate();
+        }
 
         for(int i=0; i<numTargets; i++) {
-            std::string result = runners[i].Iterate();
-            if(result == Runner::NULL_MESSAGE) {
+            //the message can't say whether there is a target, because its length depends on the config
+            if(!runners[i].LastFrameFoundTarget()) {
                 continue;
-            } else {
-                targetFound = true;
             }
 
-            Target currentClosestTarget = runners[i].GetClosestTargetToCenter();
+            //with tracking, the target that is sent can be one that was missed this frame
+            Target currentClosestTarget = runners[i].GetLastFrameSentTarget();
             
             //calculate 3d angle to target
             Point robotCenter = runners[i].GetLastFrameCenterPoint();
-            double currentHorizontalAngle = currentClosestTarget.HorizontalAngle(robotCenter.x);
-            double currentVerticalAngle   = currentClosestTarget.VerticalAngle(robotCenter.y);
-            double currentObliqueAngle    = currentClosestTarget.ObliqueAngle(robotCenter.x, robotCenter.y);
-
-            if(currentObliqueAngle < closestTargetObliqueAngle) {
-                closestTarget = currentClosestTarget;
-                closestTargetHorizontalAngle = currentHorizontalAngle;
-                closestTargetVerticalAngle   = currentVerticalAngle;
-                closestTargetObliqueAngle    = currentObliqueAngle;
-            }
-        }
-
-        //formulate string based on closest target
-        std::string message = Runner::NULL_MESSAGE;
-
-        if(targetFound) {
-            std::string
-                x  = std::to_string(closestTarget.Center().x),
-                y  = std::to_string(closestTarget.Center().y),
-                w  = std::to_string(closestTarget.Bounds().width),
-                h  = std::to_string(closestTarget.Bounds().height),
-                d  = std::to_string((int) closestTarget.Distance()),
-                ha = std::to_string((int) closestTargetHorizontalAngle),
-                va = std::to_string((int) closestTargetVerticalAngle);
-            
-            message = ":" + x + "," + y + "," + w + "," + h + "," + d + "," + ha + "," + va + ";";
+            double currentObliqueAngle = currentClosestTarget.ObliqueAngle(robotCenter.x, robotCenter.y);
+
+            if(closestRunner < 0 || currentObliqueAngle < closestTargetObliqueAngle) {
+                closestRunner = i;
+                closestTargetObliqueAngle = currentObliqueAngle;
+            }
         }
-        
-        KiwiLightApp::SendOverUDP(message);
-        logger.Log(message);
+
+        //send the message of the config with the closest target. It is sent as built, so fields that 
+        //only some configs add, like tracking predictions or the frame's age, make it through
+        //with no target anywhere, the first config's packet is sent, so a config using the binary protocol 
+        //still sends a numbered packet rather than text. The log gets the message of whichever config was sent
+        int sentRunner = std::max(closestRunner, 0);
+        KiwiLightApp::SendOverUDP(runners[sentRunner].GetLastFramePacket());
+
+        logger.Log(results[sentRunner]);
+
+        if(summaryClock.GetTime() > SUMMARY_INTERVAL) {
+            if(pipelineDepth > 0) {
+                for(int i=0; i<numTargets; i++) {
+                    std::cout << "Pipeline summary for " << runners[i].GetConfName() << ":\n" << pipelines[i]->Summary() << std::endl;
+                }
+            } else {
+                std::cout << "Config timing summary:\n" << executor->Summary() << std::endl;
+            }
+
+            publisher = KiwiLightApp::GetUDPPublisher();
+            if(publisher) {
+                std::cout << "UDP destinations:\n" << publisher->Summary() << std::endl;
+            }
+            summaryClock.Start();
+        }
+    }
+
+    //a pipeline waiting for the others to take their frame is let go, so it can stop
+    frameSource->SetConsumers(1);
+    for(int i=0; i<pipelines.size(); i++) {
+        pipelines[i]->Stop();
+    }
+
+    if(recorder) {
+        recorder->Stop();
+        Runner::SetFrameSource(recorder->GetSource());
+        std::cout << "Recording stopped (" << recorder->Summary() << ")" << std::endl;
+    }
+
+    if(usingCamera) {
+        KiwiLightApp::StopCaptureThread();
+        std::cout << "Capture thread stopped (" << KiwiLightApp::GetCaptureSummary() << ")" << std::endl;
+    } else {
+        std::cout << "Frame source finished." << std::endl;
     }
 }
 
+/**
+ * Times every supported ColorClassifier kernel against the cv::threshold(), cv::cvtColor(), and cv::inRange() 
+ * steps it replaces, and counts the pixels where their masks differ. This method will be run if the -b flag is specified.
+ */
+void BenchmarkColorKernels(std::vector<std::string> filePaths) {
+    if(filePaths.size() == 0) {
+        std::cout << "The benchmark needs a config file to take the target color from." << std::endl;
+        return;
+    }
+
+    std::shared_ptr<FrameSource> source = Runner::GetFrameSource();
+    Runner runner = Runner(filePaths[0], false, source->Live());
+    PreProcessor preprocessor = runner.GetPreProcessor();
+    int colorError = preprocessor.GetProperty(PreProcessorProperty::COLOR_ERROR);
+    Color color = Color(
+        preprocessor.GetProperty(PreProcessorProperty::COLOR_HUE), 
+        preprocessor.GetProperty(PreProcessorProperty::COLOR_SATURATION), 
+        preprocessor.GetProperty(PreProcessorProperty::COLOR_VALUE),
+        colorError, colorError, colorError
+    );
+
+    double threshold = preprocessor.GetProperty(PreProcessorProperty::THRESHOLD);
+    ColorClassifier classifier = ColorClassifier(color, threshold);
+
+    if(source->Live()) {
+        KiwiLightApp::StartCaptureThread();
+    }
+
+    std::cout << "Benchmarking color kernels on " << source->Describe() << std::endl;
+    long long opencvMicros = 0;
+    long long kernelMicros[NUMBER_OF_KERNELS] = { 0 };
+    long kernelMismatches[NUMBER_OF_KERNELS] = { 0 };
+    long frames = 0;
+    long lastFrameId = -1;
+    while(!source->Finished() && (!source->Live() || frames < BENCHMARK_CAMERA_FRAMES)) {
+        SharedFrame frame = source->Next(lastFrameId);
+        if(!frame.Valid() || frame.id == lastFrameId) {
+            continue;
+        }
+
+        lastFrameId = frame.id;
+        frames++;
+
+        //the OpenCV path, with the hue range checked a second time shifted by a full turn to match the classifier's wraparound
+        long long start = Clock::GetMonotonicTime();
+        cv::Mat thresholded, hsv, reference, wrapped;
+        cv::threshold(*frame.image, thresholded, threshold, 255, cv::THRESH_BINARY);
+        cv::cvtColor(thresholded, hsv, cv::COLOR_BGR2HSV);
+        cv::Scalar 
+            lower = color.GetLowerBound(),
+            upper = color.GetUpperBound();
+
+        cv::inRange(hsv, lower, upper, reference);
+        for(int shift=-ColorClassifier::HUE_RANGE; shift<=ColorClassifier::HUE_RANGE; shift+=2 * ColorClassifier::HUE_RANGE) {
+            cv::inRange(hsv, cv::Scalar(lower[0] + shift, lower[1], lower[2]), cv::Scalar(upper[0] + shift, upper[1], upper[2]), wrapped);
+            cv::bitwise_or(reference, wrapped, reference);
+        }
+        opencvMicros += Clock::GetMonotonicTime() - start;
+
+        for(int kernel=KERNEL_SCALAR; kernel<NUMBER_OF_KERNELS; kernel++) {
+            if(!ColorClassifier::KernelSupported((ClassifierKernel) kernel)) {
+                continue;
+            }
+
+            cv::Mat mask, difference;
+            start = Clock::GetMonotonicTime();
+            classifier.Classify(*frame.image, mask, (ClassifierKernel) kernel);
+            kernelMicros[kernel] += Clock::GetMonotonicTime() - start;
+
+            cv::bitwise_xor(reference, mask, difference);
+            kernelMismatches[kernel] += cv::countNonZero(difference);
+        }
+    }
+
+    if(source->Live()) {
+        KiwiLightApp::StopCaptureThread();
+    }
+
+    if(frames == 0) {
+        std::cout << "No frames were read." << std::endl;
+        return;
+    }
+
+    std::cout << "Frames: " << frames << std::endl;
+    std::cout << "opencv: " << (opencvMicros / (double) frames / 1000.0) << "ms avg" << std::endl;
+    for(int kernel=KERNEL_SCALAR; kernel<NUMBER_OF_KERNELS; kernel++) {
+        if(ColorClassifier::KernelSupported((ClassifierKernel) kernel)) {
+            std::cout << ColorClassifier::KERNEL_NAMES[kernel] << ": " << (kernelMicros[kernel] / (double) frames / 1000.0) << "ms avg, " 
+                      << kernelMismatches[kernel] << " pixels differ" << std::endl;
+        }
+    }
+}
+
+/**
+ * Returns the ExampleContours of a target made of "strips" 20x50 strips of tape side by side, 40 pixels apart.
+ */
+std::vector<ExampleContour> BenchmarkStrips(int strips) {
+    std::vector<ExampleContour> contours;
+    int targetWidth = (40 * (strips - 1)) + 20;
+    for(int i=0; i<strips; i++) {
+        double distX = ((20 * (strips - 1)) - (40 * i)) / (double) targetWidth;
+        contours.push_back(ExampleContour(i, SettingPair(distX, 0.05), SettingPair(0, 0.05), SettingPair(0, 15), SettingPair(0.4, 0.15), SettingPair(0.9, 0.1), 100));
+    }
+
+    return contours;
+}
+
+/**
+ * Fills "table" with a synthetic 640x480 frame of "numberOfContours" strips of tape that all pass the contour tests.
+ * A few are lined up into real targets of "strips" strips, and the rest are reflections scattered across the frame.
+ */
+void MakeBenchmarkFrame(ContourTable &table, int numberOfContours, int strips) {
+    table.Clear();
+    for(int i=0; i<numberOfContours; i++) {
+        if(i < strips * (numberOfContours / 20) && i + strips <= numberOfContours) {
+            int x = std::rand() % (620 - (40 * (strips - 1)));
+            int y = std::rand() % 430;
+            for(int s=0; s<strips; s++) {
+                table.Add(Contour(x + (40 * s), y, 20, 50, 0, 0.95));
+            }
+            i += strips - 1;
+        } else {
+            table.Add(Contour(std::rand() % 620, std::rand() % 430, 20, 50, 0, 0.95));
+        }
+    }
+}
+
+/**
+ * Returns true if "contours" is a target of "target", by trying every way of giving each contour its own contour 
+ * of the target. Each contour must pass its ExampleContour and sit the right number of target widths from the 
+ * center of the group, which is the test targets used before the role search. The benchmark checks the search against it.
+ */
+bool FitsByEveryAssignment(ExampleTarget &target, const std::vector<Contour> &contours) {
+    std::vector<ExampleContour> roles = target.Contours();
+    if(roles.size() != contours.size()) {
+        return false;
+    }
+
+    cv::Rect bounds = Target::BoundsOf(contours.data(), contours.size());
+    int centerX = (bounds.width / 2) + bounds.x;
+    int centerY = (bounds.height / 2) + bounds.y;
+    int objectWidth = bounds.width;
+
+    std::vector<int> assignment = std::vector<int>(roles.size());
+    for(int i=0; i<assignment.size(); i++) {
+        assignment[i] = i;
+    }
+
+    do {
+        bool fits = true;
+        for(int i=0; i<contours.size() && fits; i++) {
+            Contour object = contours[i];
+            ExampleContour &role = roles[assignment[i]];
+            double widthsToCenterX = (centerX - object.Center().x) / (double) objectWidth;
+            double widthsToCenterY = (centerY - object.Center().y) / (double) objectWidth;
+
+            fits = widthsToCenterX > role.DistX().LowerBound() && widthsToCenterX < role.DistX().UpperBound() &&
+                   widthsToCenterY > role.DistY().LowerBound() && widthsToCenterY < role.DistY().UpperBound() &&
+                   role.IsContour(object);
+        }
+
+        if(fits) {
+            return true;
+        }
+    } while(std::next_permutation(assignment.begin(), assignment.end()));
+
+    return false;
+}
+
+/**
+ * Times ExampleTarget::GetTargets() on synthetic frames full of strips of tape, looking for a target of three strips 
+ * side by side. On the first few frames the targets found are checked against testing every combination of three strips 
+ * with FitsByEveryAssignment(), which does not use the TargetMatcher.
+ * Then the TargetMatcher searches built for targets of one, two, and three contours are timed against the generic 
+ * search on the same kind of frames. This method will be run if the -m flag is specified.
+ */
+void BenchmarkMatcher(int numberOfContours) {
+    ExampleTarget target = ExampleTarget(0, BenchmarkStrips(3), 1, 1, 1, 1, DistanceCalcMode::BY_WIDTH);
+
+    std::cout << "Benchmarking the target matcher on " << MATCHER_BENCHMARK_FRAMES << " frames of " << numberOfContours << " strips each" << std::endl;
+
+    ContourTable table;
+    std::vector<Target> targets;
+    FrameArena arena;
+    std::srand(3695);
+
+    long long totalMicros = 0;
+    long long worstMicros = 0;
+    long totalTargets = 0;
+    long long checkedMicros = 0;
+    int framesThatDiffer = 0;
+    for(int frame=0; frame<MATCHER_BENCHMARK_FRAMES; frame++) {
+        MakeBenchmarkFrame(table, numberOfContours, 3);
+
+        arena.Reset();
+        long long start = Clock::GetMonotonicTime();
+        target.GetTargets(table, targets, arena);
+        long long micros = Clock::GetMonotonicTime() - start;
+        totalMicros += micros;
+        worstMicros = std::max(worstMicros, micros);
+        totalTargets += targets.size();
+
+        //every target kept must be a real one, and if any combination is a target, at least one must be kept
+        if(frame < MATCHER_CHECKED_FRAMES) {
+            start = Clock::GetMonotonicTime();
+            int targetsInCombinations = 0;
+            std::vector<Contour> combination = std::vector<Contour>(3);
+            for(int a=0; a<numberOfContours; a++) {
+                for(int b=a + 1; b<numberOfContours; b++) {
+                    for(int c=b + 1; c<numberOfContours; c++) {
+                        combination[0] = table.Get(a);
+                        combination[1] = table.Get(b);
+                        combination[2] = table.Get(c);
+                        if(FitsByEveryAssignment(target, combination)) {
+                            targetsInCombinations++;
+                        }
+                    }
+                }
+            }
+            checkedMicros += Clock::GetMonotonicTime() - start;
+
+            bool allReal = true;
+            for(int t=0; t<targets.size(); t++) {
+                allReal = allReal && FitsByEveryAssignment(target, targets[t].Contours());
+            }
+
+            if(!allReal || (targetsInCombinations > 0) != (targets.size() > 0)) {
+                framesThatDiffer++;
+            }
+        }
+    }
+
+    std::cout << "matcher: " << (totalMicros / (double) MATCHER_BENCHMARK_FRAMES / 1000.0) << "ms avg, " 
+              << (worstMicros / 1000.0) << "ms worst, " 
+              << (totalTargets / (double) MATCHER_BENCHMARK_FRAMES) << " targets kept per frame (at most " << ExampleTarget::MAX_TARGETS << ")" << std::endl;
+
+    std::cout << "every combination: " << (checkedMicros / (double) MATCHER_CHECKED_FRAMES / 1000.0) << "ms avg, " 
+              << "found different targets on " << framesThatDiffer << " of " << MATCHER_CHECKED_FRAMES << " frames" << std::endl;
+
+    //the searches built for a fixed number of contours against the generic one
+    std::vector<unsigned char> accepted;
+    std::vector<int> validRows;
+    for(int strips=1; strips<=TargetMatcher::MAX_FIXED_ROLES; strips++) {
+        std::vector<ExampleContour> contours = BenchmarkStrips(strips);
+        TargetMatcher::BestGroupsMethod fixedSearch = TargetMatcher::BestGroupsFor(strips);
+        long long fixedMicros = 0;
+        long long genericMicros = 0;
+        framesThatDiffer = 0;
+        std::srand(3695);
+
+        for(int frame=0; frame<MATCHER_BENCHMARK_FRAMES; frame++) {
+            MakeBenchmarkFrame(table, numberOfContours, strips);
+            int rows = table.Size();
+            accepted.resize(strips * rows);
+            for(int k=0; k<strips; k++) {
+                contours[k].TestContours(table, accepted.data() + (k * rows));
+            }
+
+            validRows.clear();
+            for(int i=0; i<rows; i++) {
+                for(int k=0; k<strips; k++) {
+                    if(accepted[(k * rows) + i]) {
+                        validRows.push_back(i);
+                        break;
+                    }
+                }
+            }
+
+            arena.Reset();
+            TargetMatcher matcher = TargetMatcher(contours, table, accepted.data(), validRows.data(), validRows.size(), arena);
+            ArenaVector<int> fixedGroups = ArenaVector<int>(ArenaAllocator<int>(&arena));
+            ArenaVector<int> genericGroups = ArenaVector<int>(ArenaAllocator<int>(&arena));
+            ArenaVector<double> fixedFits = ArenaVector<double>(ArenaAllocator<double>(&arena));
+            ArenaVector<double> genericFits = ArenaVector<double>(ArenaAllocator<double>(&arena));
+
+            //each search runs a few times so the clock can see it
+            for(int run=0; run<MATCHER_BENCHMARK_RUNS; run++) {
+                fixedGroups.clear();
+                fixedFits.clear();
+                long long start = Clock::GetMonotonicTime();
+                (matcher.*fixedSearch)(fixedGroups, fixedFits, ExampleTarget::MAX_TARGETS);
+                fixedMicros += Clock::GetMonotonicTime() - start;
+
+                genericGroups.clear();
+                genericFits.clear();
+                start = Clock::GetMonotonicTime();
+                matcher.FindBestGroups<0>(genericGroups, genericFits, ExampleTarget::MAX_TARGETS);
+                genericMicros += Clock::GetMonotonicTime() - start;
+            }
+
+            if(fixedGroups != genericGroups || fixedFits != genericFits) {
+                framesThatDiffer++;
+            }
+        }
+
+        double searches = MATCHER_BENCHMARK_FRAMES * MATCHER_BENCHMARK_RUNS;
+        std::cout << strips << " contour search: " << (fixedMicros / searches / 1000.0) << "ms avg built for " << strips << ", " 
+                  << (genericMicros / searches / 1000.0) << "ms avg generic, results differ on " << framesThatDiffer << " frames" << std::endl;
+    }
+}
+
+/**
+ * Fills "fields" with the OUTPUT_BENCHMARK_FIELDS numbers of a made-up message, different for every "message".
+ */
+void MakeOutputBenchmarkFields(int fields[], int message) {
+    fields[0] = message % 640;       //x
+    fields[1] = (message * 7) % 480; //y
+    fields[2] = 20 + (message % 50); //width
+    fields[3] = 50 + (message % 30); //height
+    fields[4] = 30 + (message % 200);//distance
+    fields[5] = (message % 61) - 30; //horizontal angle
+    fields[6] = (message % 41) - 20; //vertical angle
+}
+
+/**
+ * Builds a message the way the Runner used to, with a std::to_string() for every field joined into a new string.
+ */
+std::string FormatWithStrings(int fields[]) {
+    std::string x = std::to_string(fields[0]),
+                y = std::to_string(fields[1]),
+                w = std::to_string(fields[2]),
+                h = std::to_string(fields[3]),
+                d = std::to_string(fields[4]),
+                ax = std::to_string(fields[5]),
+                ay = std::to_string(fields[6]);
+
+    return ":" + x + "," + y + "," + w + "," + h + "," + d + "," + ax + "," + ay + ";";
+}
+
+/**
+ * Builds a message the way the Runner does now, into the buffer of "writer".
+ */
+void FormatWithWriter(MessageWriter &writer, int fields[]) {
+    writer.Append(':');
+    for(int i=0; i<OUTPUT_BENCHMARK_FIELDS; i++) {
+        if(i > 0) {
+            writer.Append(',');
+        }
+
+        writer.Append(fields[i]);
+    }
+    writer.Append(';');
+}
+
+/**
+ * Sends "message" the way UDP::Send() used to take it, as a copy.
+ */
+void SendCopy(UDP &udp, std::string message) {
+    udp.Send(message);
+}
+
+/**
+ * Times building messages for the RIO with std::to_string() and string concatenation, like the Runner used to, 
+ * against formatting them with a MessageWriter into a buffer on the stack. Both are timed building the messages alone, 
+ * then building and sending each one over UDP. This method will be run if the -o flag is specified.
+ */
+void BenchmarkOutput(int messages) {
+    UDP udp = UDP("127.0.0.1", 3695, false);
+    int fields[OUTPUT_BENCHMARK_FIELDS];
+    std::cout << "Benchmarking the output of " << messages << " messages" << std::endl;
+
+    //make sure both ways build the same bytes before timing them
+    int messagesThatDiffer = 0;
+    for(int i=0; i<messages; i++) {
+        MakeOutputBenchmarkFields(fields, i);
+        char buffer[Runner::MAX_MESSAGE_SIZE];
+        MessageWriter writer = MessageWriter(buffer, Runner::MAX_MESSAGE_SIZE);
+        FormatWithWriter(writer, fields);
+        if(FormatWithStrings(fields) != std::string(writer.Data(), writer.Size())) {
+            messagesThatDiffer++;
+        }
+    }
+
+    const std::string passNames[2] = { "build", "build and send" };
+    for(int pass=0; pass<2; pass++) {
+        bool sending = (pass == 1);
+        long long totalBytes = 0; //used, so that building the messages can't be optimized out when nothing is sent
+
+        long long allocationsBefore = AllocationCounter::Count();
+        long long start = Clock::GetMonotonicTime();
+        for(int i=0; i<messages; i++) {
+            MakeOutputBenchmarkFields(fields, i);
+            std::string message = FormatWithStrings(fields);
+            if(sending) {
+                SendCopy(udp, message);
+            }
+            totalBytes += message.size();
+        }
+        long long stringMicros = Clock::GetMonotonicTime() - start;
+        long long stringAllocations = AllocationCounter::Count() - allocationsBefore;
+
+        allocationsBefore = AllocationCounter::Count();
+        start = Clock::GetMonotonicTime();
+        for(int i=0; i<messages; i++) {
+            MakeOutputBenchmarkFields(fields, i);
+            char buffer[Runner::MAX_MESSAGE_SIZE];
+            MessageWriter writer = MessageWriter(buffer, Runner::MAX_MESSAGE_SIZE);
+            FormatWithWriter(writer, fields);
+            if(sending) {
+                udp.Send(writer.Data(), writer.Size());
+            }
+            totalBytes += writer.Size();
+        }
+        long long writerMicros = Clock::GetMonotonicTime() - start;
+        long long writerAllocations = AllocationCounter::Count() - allocationsBefore;
+
+        std::cout << passNames[pass] << ": " << (stringMicros * 1000.0 / messages) << "ns avg with strings, " 
+                  << (writerMicros * 1000.0 / messages) << "ns avg with a MessageWriter (" << totalBytes << " bytes)" << std::endl;
+        if(AllocationCounter::Enabled()) {
+            std::cout << "    heap allocations per message: " << (stringAllocations / (double) messages) << " with strings, " 
+                      << (writerAllocations / (double) messages) << " with a MessageWriter" << std::endl;
+        }
+    }
+
+    std::cout << "messages that differ: " << messagesThatDiffer << std::endl;
+    udp.Close();
+}
+
 /**
  * Test method. This method will be run if the -t flag is specified.
  */
@@ -153,6 +694,9 @@ int main(int argc, char *argv[]) {
         KiwiLightApp::Start();
     } else {
         bool runningConfig = false;
+        bool runningBenchmark = false;
+        bool runningMatcherBenchmark = false;
+        bool runningOutputBenchmark = false;
         bool showHelp = false;
         std::vector<std::string> confsToRun;
 
@@ -168,6 +712,52 @@ int main(int argc, char *argv[]) {
                 runningConfig = true;
             }
 
+            if(argument == "-p") {
+                pipelineDepth = RunnerPipeline::DEFAULT_QUEUE_DEPTH;
+                if(i + 1 < argc && isdigit(argv[i + 1][0])) {
+                    pipelineDepth = std::max(1, std::stoi(argv[i + 1]));
+                }
+            }
+
+            if(argument == "-s" && i + 1 < argc) {
+                std::shared_ptr<FrameSource> source = FrameSource::Create(argv[i + 1]);
+                if(!source) {
+                    std::cout << "Unrecognized frame source \"" << argv[i + 1] << "\". Use \"KiwiLight -h\" to see the options." << std::endl;
+                    return 1;
+                }
+
+                Runner::SetFrameSource(source);
+            }
+
+            if(argument == "-k" && i + 1 < argc) {
+                if(!ColorClassifier::SetKernel(argv[i + 1])) {
+                    std::cout << "The color kernel \"" << argv[i + 1] << "\" is unknown or not supported by this CPU." << std::endl;
+                    return 1;
+                }
+            }
+
+            if(argument == "-b") {
+                runningBenchmark = true;
+            }
+
+            if(argument == "-m") {
+                runningMatcherBenchmark = true;
+                if(i + 1 < argc && isdigit(argv[i + 1][0])) {
+                    matcherBenchmarkContours = std::max(1, std::stoi(argv[i + 1]));
+                }
+            }
+
+            if(argument == "-o") {
+                runningOutputBenchmark = true;
+                if(i + 1 < argc && isdigit(argv[i + 1][0])) {
+                    outputBenchmarkMessages = std::max(1, std::stoi(argv[i + 1]));
+                }
+            }
+
+            if(argument == "-r" && i + 1 < argc) {
+                recordingFile = std::string(argv[i + 1]);
+            }
+
             if(argument == "-h") {
                 ShowHelp();
 
@@ -185,11 +775,17 @@ int main(int argc, char *argv[]) {
             }
         }
 
-        if(runningConfig) {
+        if(runningOutputBenchmark) {
+            BenchmarkOutput(outputBenchmarkMessages);
+        } else if(runningMatcherBenchmark) {
+            BenchmarkMatcher(matcherBenchmarkContours);
+        } else if(runningBenchmark) {
+            BenchmarkColorKernels(confsToRun);
+        } else if(runningConfig) {
             RunConfigs(confsToRun);
         }
 
-        if(!(runningConfig || showHelp)) {
+        if(!(runningConfig || runningBenchmark || runningMatcherBenchmark || runningOutputBenchmark || showHelp)) {
             std::cout << "No valid command arguments found.\n";
             std::cout << "Use \"KiwiLight -h\" to see the command options, or just \"KiwiLight\" to launch the GUI!" << std::endl;
         }
@@ -0,0 +1,138 @@
+#include "Runner.h"
+
+/**
+ * Source file for the BinaryMorphology class.
+ * Written By: Brach Knutson
+ */
+
+using namespace cv;
+using namespace KiwiLight;
+
+//kernels this big or bigger would need to shift bits across more than one word
+const int BinaryMorphology::MAX_KERNEL_SIZE = 64;
+
+/**
+ * Erodes and then dilates "mask" with square kernels, like cv::erode() followed by cv::dilate().
+ * Kernels that are too big are handed to OpenCV instead.
+ * @param mask A single channel mask where every pixel is 0 or 255.
+ * @param out The Mat to write the result to. May be "mask". Its buffer is reused when the size matches.
+ * @param erosion The width and height of the erosion kernel.
+ * @param dilation The width and height of the dilation kernel.
+ */
+void BinaryMorphology::Apply(const cv::Mat &mask, cv::Mat &out, int erosion, int dilation) {
+    //like OpenCV, an empty kernel means 3x3
+    erosion  = (erosion  <= 0 ? 3 : erosion);
+    dilation = (dilation <= 0 ? 3 : dilation);
+
+    if(erosion >= MAX_KERNEL_SIZE || dilation >= MAX_KERNEL_SIZE) {
+        cv::erode(mask, out, cv::getStructuringElement(cv::MORPH_RECT, cv::Size(erosion, erosion)));
+        cv::dilate(out, out, cv::getStructuringElement(cv::MORPH_RECT, cv::Size(dilation, dilation)));
+        return;
+    }
+
+    Pack(mask);
+    Filter(erosion, true);
+    Filter(dilation, false);
+    Unpack(out);
+}
+
+/**
+ * Packs "mask" into bits, one row after another. Bit b of word w in a row is pixel 64 * w + b.
+ */
+void BinaryMorphology::Pack(const cv::Mat &mask) {
+    this->rows = mask.rows;
+    this->cols = mask.cols;
+    this->wordsPerRow = (mask.cols + 63) / 64;
+    this->packed.resize(this->rows * this->wordsPerRow);
+    this->scratch.resize(this->packed.size());
+
+    for(int r=0; r<this->rows; r++) {
+        const uchar *in = mask.ptr(r);
+        uint64_t *words = &this->packed[r * this->wordsPerRow];
+        for(int w=0; w<this->wordsPerRow; w++) {
+            uint64_t word = 0;
+            int end = std::min(64, this->cols - w * 64);
+            for(int b=0; b<end; b++) {
+                word |= (uint64_t) (in[w * 64 + b] >> 7) << b;
+            }
+            words[w] = word;
+        }
+    }
+}
+
+/**
+ * Writes the packed mask to "out" as 0s and 255s.
+ */
+void BinaryMorphology::Unpack(cv::Mat &out) {
+    out.create(this->rows, this->cols, CV_8UC1);
+    for(int r=0; r<this->rows; r++) {
+        uchar *pixels = out.ptr(r);
+        const uint64_t *words = &this->packed[r * this->wordsPerRow];
+        for(int c=0; c<this->cols; c++) {
+            pixels[c] = (uchar) -((words[c / 64] >> (c % 64)) & 1);
+        }
+    }
+}
+
+/**
+ * Erodes or dilates the packed mask with a size x size square, anchored in the middle like OpenCV's kernels. 
+ * Pixels outside of the image never change the result, so they count as set when eroding and clear when dilating.
+ * The square is done as a horizontal pass followed by a vertical pass, which gives the same result.
+ */
+void BinaryMorphology::Filter(int size, bool eroding) {
+    if(size <= 1) {
+        return;
+    }
+
+    const int 
+        first = -(size / 2),   //offset of the kernel's first pixel from its anchor
+        last  = size - 1 + first;
+    const uint64_t outside = (eroding ? ~0ULL : 0ULL);
+    const int lastWordBits = this->cols - (this->wordsPerRow - 1) * 64;
+    const uint64_t lastWordPadding = (lastWordBits == 64 ? 0ULL : ~0ULL << lastWordBits);
+
+    //horizontal: combine each pixel with its neighbors "first" through "last" pixels to its right
+    for(int r=0; r<this->rows; r++) {
+        uint64_t *words = &this->packed[r * this->wordsPerRow];
+        uint64_t *filtered = &this->scratch[r * this->wordsPerRow];
+
+        //bits past the end of the row act like the outside of the image
+        words[this->wordsPerRow - 1] = (words[this->wordsPerRow - 1] & ~lastWordPadding) | (outside & lastWordPadding);
+
+        for(int w=0; w<this->wordsPerRow; w++) {
+            uint64_t 
+                previous = (w > 0 ? words[w - 1] : outside),
+                current  = words[w],
+                next     = (w < this->wordsPerRow - 1 ? words[w + 1] : outside),
+                result   = current;
+
+            for(int offset=first; offset<=last; offset++) {
+                uint64_t shifted = current;
+                if(offset > 0) {
+                    shifted = (current >> offset) | (next << (64 - offset));
+                } else if(offset < 0) {
+                    shifted = (current << -offset) | (previous >> (64 + offset));
+                }
+
+                result = (eroding ? result & shifted : result | shifted);
+            }
+
+            filtered[w] = result;
+        }
+    }
+
+    //vertical: combine each row with the rows "first" through "last" rows below it
+    for(int r=0; r<this->rows; r++) {
+        uint64_t *words = &this->packed[r * this->wordsPerRow];
+        for(int w=0; w<this->wordsPerRow; w++) {
+            uint64_t result = this->scratch[r * this->wordsPerRow + w];
+            for(int offset=first; offset<=last; offset++) {
+                int row = r + offset;
+                uint64_t neighbor = (row >= 0 && row < this->rows ? this->scratch[row * this->wordsPerRow + w] : outside);
+                result = (eroding ? result & neighbor : result | neighbor);
+            }
+
+            words[w] = result;
+        }
+    }
+}
@@ -0,0 +1,17 @@
+#include "../KiwiLight.h"
+
+/**
+ * Source file for the CameraFrameSource class.
+ * Written By: Brach Knutson
+ */
+
+using namespace cv;
+using namespace KiwiLight;
+
+/**
+ * Returns the newest frame from the camera. Callers asking for a frame after the same id get the same image.
+ * @param afterId The id of the last frame the caller processed.
+ */
+SharedFrame CameraFrameSource::Next(long afterId) {
+    return KiwiLightApp::TakeSharedFrame(afterId);
+}
@@ -0,0 +1,349 @@
+#include "Runner.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define KIWILIGHT_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define KIWILIGHT_NEON_KERNEL
+#include <arm_neon.h>
+#endif
+
+/**
+ * Source file for the ColorClassifier class.
+ * Written By: Brach Knutson
+ */
+
+using namespace cv;
+using namespace KiwiLight;
+
+//number of hues in an 8-bit HSV image. Hue 0 comes right after the last one.
+const int ColorClassifier::HUE_RANGE = 180;
+
+const std::string ColorClassifier::KERNEL_NAMES[NUMBER_OF_KERNELS] = { "auto", "scalar", "ssse3", "avx2", "neon" };
+
+ClassifierKernel ColorClassifier::kernel = ClassifierKernel::KERNEL_AUTO;
+
+/**
+ * Returns true if "kernel" can run on this CPU, false otherwise.
+ */
+bool ColorClassifier::KernelSupported(ClassifierKernel kernel) {
+    switch(kernel) {
+        case ClassifierKernel::KERNEL_AUTO:
+        case ClassifierKernel::KERNEL_SCALAR:
+            return true;
+        #ifdef KIWILIGHT_X86_KERNELS
+        case ClassifierKernel::KERNEL_SSSE3:
+            return __builtin_cpu_supports("ssse3");
+        case ClassifierKernel::KERNEL_AVX2:
+            return __builtin_cpu_supports("avx2");
+        #endif
+        #ifdef KIWILIGHT_NEON_KERNEL
+        case ClassifierKernel::KERNEL_NEON:
+            return true;
+        #endif
+        default:
+            return false;
+    }
+}
+
+/**
+ * Chooses the kernel that all ColorClassifiers use. Should be called before any frames are processed.
+ * @param name One of KERNEL_NAMES.
+ * @return True if the kernel was chosen, false if it is unknown or not supported by this CPU.
+ */
+bool ColorClassifier::SetKernel(std::string name) {
+    for(int i=0; i<NUMBER_OF_KERNELS; i++) {
+        if(KERNEL_NAMES[i] == name && KernelSupported((ClassifierKernel) i)) {
+            ColorClassifier::kernel = (ClassifierKernel) i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Returns the kernel that ColorClassifiers use. KERNEL_AUTO is resolved to the fastest supported kernel.
+ */
+ClassifierKernel ColorClassifier::GetKernel() {
+    if(ColorClassifier::kernel != ClassifierKernel::KERNEL_AUTO) {
+        return ColorClassifier::kernel;
+    }
+
+    const ClassifierKernel fastestFirst[] = { KERNEL_AVX2, KERNEL_NEON, KERNEL_SSSE3 };
+    for(int i=0; i<3; i++) {
+        if(KernelSupported(fastestFirst[i])) {
+            return fastestFirst[i];
+        }
+    }
+
+    return ClassifierKernel::KERNEL_SCALAR;
+}
+
+/**
+ * Creates a new ColorClassifier. Gives the same result as thresholding each channel, converting to HSV, 
+ * and checking the range of "targetColor", except that hue ranges wrap around (so red targets work).
+ * @param targetColor The color to look for.
+ * @param threshold Channel values above this count as full brightness, and the rest count as dark.
+ */
+ColorClassifier::ColorClassifier(Color targetColor, double threshold) {
+    //same rounding as cv::threshold() for 8-bit images
+    int thresh = cvFloor(threshold);
+    this->threshold = (uchar) std::min(std::max(thresh, 0), 254);
+    for(int channel=0; channel<3; channel++) {
+        for(int value=0; value<256; value++) {
+            this->channelBits[channel][value] = (value > thresh ? 1 << channel : 0);
+        }
+    }
+
+    //convert every possible class with OpenCV so the hues and saturations match cvtColor() exactly
+    cv::Mat classColors = cv::Mat(1, 8, CV_8UC3);
+    for(int colorClass=0; colorClass<8; colorClass++) {
+        uchar *pixel = classColors.ptr(0) + colorClass * 3;
+        for(int channel=0; channel<3; channel++) {
+            pixel[channel] = (colorClass & (1 << channel) ? 255 : 0);
+        }
+    }
+
+    cv::Mat classHSV;
+    cv::cvtColor(classColors, classHSV, cv::COLOR_BGR2HSV);
+
+    cv::Scalar 
+        lower = targetColor.GetLowerBound(),
+        upper = targetColor.GetUpperBound();
+
+    for(int colorClass=0; colorClass<8; colorClass++) {
+        const uchar *pixel = classHSV.ptr(0) + colorClass * 3;
+        int h = pixel[0],
+            s = pixel[1],
+            v = pixel[2];
+
+        bool hueMatches = (h >= lower[0] && h <= upper[0]) || 
+                          (h + HUE_RANGE >= lower[0] && h + HUE_RANGE <= upper[0]) ||
+                          (h - HUE_RANGE >= lower[0] && h - HUE_RANGE <= upper[0]);
+
+        bool matches = hueMatches && s >= lower[1] && s <= upper[1] && v >= lower[2] && v <= upper[2];
+        this->classMask[colorClass] = (matches ? 255 : 0);
+    }
+
+    //when every pixel lands in the same class, the vector kernels' clamped threshold must not matter
+    for(int colorClass=0; colorClass<8; colorClass++) {
+        if(thresh < 0) {
+            this->classMask[colorClass] = this->classMask[7];
+        } else if(thresh > 254) {
+            this->classMask[colorClass] = this->classMask[0];
+        }
+    }
+
+    for(int i=8; i<16; i++) {
+        this->classMask[i] = 0;
+    }
+}
+
+/**
+ * Writes a mask of "img" to "mask", where pixels of the target color are 255 and the rest are 0.
+ * Uses the kernel chosen with SetKernel().
+ * @param img An 8-bit BGR image.
+ * @param mask The Mat to write the mask into. Its buffer is reused when the size matches.
+ */
+void ColorClassifier::Classify(const cv::Mat &img, cv::Mat &mask) const {
+    Classify(img, mask, GetKernel());
+}
+
+/**
+ * Writes a mask of "img" to "mask" using "kernel". Every kernel gives exactly the same mask.
+ * @param img An 8-bit BGR image.
+ * @param mask The Mat to write the mask into. Its buffer is reused when the size matches.
+ * @param kernel The kernel to use. Must be supported by this CPU.
+ */
+void ColorClassifier::Classify(const cv::Mat &img, cv::Mat &mask, ClassifierKernel kernel) const {
+    mask.create(img.rows, img.cols, CV_8UC1);
+
+    for(int r=0; r<img.rows; r++) {
+        const uchar *in = img.ptr(r);
+        uchar *out = mask.ptr(r);
+
+        switch(kernel) {
+            case ClassifierKernel::KERNEL_AVX2:
+                ClassifyRowAVX2(in, out, img.cols);
+                break;
+            case ClassifierKernel::KERNEL_SSSE3:
+                ClassifyRowSSSE3(in, out, img.cols);
+                break;
+            case ClassifierKernel::KERNEL_NEON:
+                ClassifyRowNEON(in, out, img.cols);
+                break;
+            default:
+                ClassifyRowScalar(in, out, img.cols);
+                break;
+        }
+    }
+}
+
+/**
+ * Classifies one row of pixels with plain table lookups.
+ * @param in The row's BGR pixels.
+ * @param out Where to write the row's mask.
+ * @param width The number of pixels in the row.
+ */
+void ColorClassifier::ClassifyRowScalar(const uchar *in, uchar *out, int width) const {
+    const uchar 
+        *blueBits  = this->channelBits[0],
+        *greenBits = this->channelBits[1],
+        *redBits   = this->channelBits[2];
+
+    for(int c=0; c<width; c++, in += 3) {
+        out[c] = this->classMask[blueBits[in[0]] | greenBits[in[1]] | redBits[in[2]]];
+    }
+}
+
+#ifdef KIWILIGHT_X86_KERNELS
+
+/**
+ * Byte shuffles that pull one channel out of 16 BGR pixels spread over three 16-byte registers.
+ * Row 3 * channel + register picks that channel's bytes from that register, and -1 leaves a zero.
+ */
+static const signed char CHANNEL_SHUFFLES[9][16] = {
+    {  0,  3,  6,  9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 }, //blue
+    { -1, -1, -1, -1, -1, -1,  2,  5,  8, 11, 14, -1, -1, -1, -1, -1 },
+    { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  1,  4,  7, 10, 13 },
+    {  1,  4,  7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 }, //green
+    { -1, -1, -1, -1, -1,  0,  3,  6,  9, 12, 15, -1, -1, -1, -1, -1 },
+    { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  2,  5,  8, 11, 14 },
+    {  2,  5,  8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 }, //red
+    { -1, -1, -1, -1, -1,  1,  4,  7, 10, 13, -1, -1, -1, -1, -1, -1 },
+    { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  3,  6,  9, 12, 15 }
+};
+
+#pragma GCC push_options
+#pragma GCC target("ssse3")
+
+/**
+ * Classifies one row of pixels 16 at a time with SSSE3.
+ * @param in The row's BGR pixels.
+ * @param out Where to write the row's mask.
+ * @param width The number of pixels in the row.
+ */
+void ColorClassifier::ClassifyRowSSSE3(const uchar *in, uchar *out, int width) const {
+    __m128i shuffles[9];
+    for(int i=0; i<9; i++) {
+        shuffles[i] = _mm_loadu_si128((const __m128i*) CHANNEL_SHUFFLES[i]);
+    }
+
+    const __m128i 
+        threshold = _mm_set1_epi8((char) this->threshold),
+        table     = _mm_loadu_si128((const __m128i*) this->classMask);
+
+    int c = 0;
+    for(; c + 16 <= width; c += 16, in += 48) {
+        __m128i registers[3] = {
+            _mm_loadu_si128((const __m128i*) in),
+            _mm_loadu_si128((const __m128i*) (in + 16)),
+            _mm_loadu_si128((const __m128i*) (in + 32))
+        };
+
+        __m128i colorClass = _mm_setzero_si128();
+        for(int channel=0; channel<3; channel++) {
+            __m128i values = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(registers[0], shuffles[channel * 3]), 
+                                                       _mm_shuffle_epi8(registers[1], shuffles[channel * 3 + 1])), 
+                                                       _mm_shuffle_epi8(registers[2], shuffles[channel * 3 + 2]));
+
+            //a value is above the threshold when it isn't the smaller of the two
+            __m128i dark = _mm_cmpeq_epi8(_mm_min_epu8(values, threshold), values);
+            colorClass = _mm_or_si128(colorClass, _mm_andnot_si128(dark, _mm_set1_epi8(1 << channel)));
+        }
+
+        _mm_storeu_si128((__m128i*) (out + c), _mm_shuffle_epi8(table, colorClass));
+    }
+
+    ClassifyRowScalar(in, out + c, width - c);
+}
+
+#pragma GCC pop_options
+#pragma GCC push_options
+#pragma GCC target("avx2")
+
+/**
+ * Classifies one row of pixels 32 at a time with AVX2. Each 128-bit lane works on 16 pixels 
+ * exactly like the SSSE3 kernel, since AVX2 byte shuffles can't cross lanes.
+ * @param in The row's BGR pixels.
+ * @param out Where to write the row's mask.
+ * @param width The number of pixels in the row.
+ */
+void ColorClassifier::ClassifyRowAVX2(const uchar *in, uchar *out, int width) const {
+    __m256i shuffles[9];
+    for(int i=0; i<9; i++) {
+        shuffles[i] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*) CHANNEL_SHUFFLES[i]));
+    }
+
+    const __m256i 
+        threshold = _mm256_set1_epi8((char) this->threshold),
+        table     = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*) this->classMask));
+
+    int c = 0;
+    for(; c + 32 <= width; c += 32, in += 96) {
+        //low lanes hold pixels 0-15 and high lanes hold pixels 16-31
+        __m256i registers[3];
+        for(int i=0; i<3; i++) {
+            registers[i] = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*) (in + i * 16))), 
+                                                   _mm_loadu_si128((const __m128i*) (in + 48 + i * 16)), 1);
+        }
+
+        __m256i colorClass = _mm256_setzero_si256();
+        for(int channel=0; channel<3; channel++) {
+            __m256i values = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(registers[0], shuffles[channel * 3]), 
+                                                             _mm256_shuffle_epi8(registers[1], shuffles[channel * 3 + 1])), 
+                                                             _mm256_shuffle_epi8(registers[2], shuffles[channel * 3 + 2]));
+
+            __m256i dark = _mm256_cmpeq_epi8(_mm256_min_epu8(values, threshold), values);
+            colorClass = _mm256_or_si256(colorClass, _mm256_andnot_si256(dark, _mm256_set1_epi8(1 << channel)));
+        }
+
+        _mm256_storeu_si256((__m256i*) (out + c), _mm256_shuffle_epi8(table, colorClass));
+    }
+
+    ClassifyRowScalar(in, out + c, width - c);
+}
+
+#pragma GCC pop_options
+
+#else
+
+void ColorClassifier::ClassifyRowSSSE3(const uchar *in, uchar *out, int width) const {
+    ClassifyRowScalar(in, out, width);
+}
+
+void ColorClassifier::ClassifyRowAVX2(const uchar *in, uchar *out, int width) const {
+    ClassifyRowScalar(in, out, width);
+}
+
+#endif
+
+/**
+ * Classifies one row of pixels 16 at a time with NEON.
+ * @param in The row's BGR pixels.
+ * @param out Where to write the row's mask.
+ * @param width The number of pixels in the row.
+ */
+void ColorClassifier::ClassifyRowNEON(const uchar *in, uchar *out, int width) const {
+    int c = 0;
+
+    #ifdef KIWILIGHT_NEON_KERNEL
+    const uint8x16_t threshold = vdupq_n_u8(this->threshold);
+    const uint8x8_t table = vld1_u8(this->classMask);
+
+    for(; c + 16 <= width; c += 16, in += 48) {
+        uint8x16x3_t pixels = vld3q_u8(in); //loads and splits the channels in one go
+
+        uint8x16_t colorClass = vandq_u8(vcgtq_u8(pixels.val[0], threshold), vdupq_n_u8(1));
+        colorClass = vorrq_u8(colorClass, vandq_u8(vcgtq_u8(pixels.val[1], threshold), vdupq_n_u8(2)));
+        colorClass = vorrq_u8(colorClass, vandq_u8(vcgtq_u8(pixels.val[2], threshold), vdupq_n_u8(4)));
+
+        vst1q_u8(out + c, vcombine_u8(vtbl1_u8(table, vget_low_u8(colorClass)), vtbl1_u8(table, vget_high_u8(colorClass))));
+    }
+    #endif
+
+    ClassifyRowScalar(in, out + c, width - c);
+}
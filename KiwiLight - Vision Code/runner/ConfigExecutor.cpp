@@ -0,0 +1,114 @@
+#include "Runner.h"
+
+/**
+ * Source file for the ConfigExecutor class.
+ * Written By: Brach Knutson
+ */
+
+using namespace cv;
+using namespace KiwiLight;
+
+/**
+ * Creates a new ConfigExecutor.
+ * @param runners The Runners to execute. They must outlive the executor.
+ * @param numRunners The number of Runners in "runners".
+ */
+ConfigExecutor::ConfigExecutor(Runner *runners, int numRunners) {
+    this->runners = runners;
+    this->lastFrameId = -1;
+    this->results = std::vector<std::string>(numRunners, Runner::NULL_MESSAGE);
+    this->stats = std::vector<ConfigStats>(numRunners);
+
+    //a single config gains nothing from being handed to another thread
+    if(numRunners > 1) {
+        this->pool = std::unique_ptr<ThreadPool>(new ThreadPool(numRunners));
+    }
+}
+
+/**
+ * Takes one frame, runs every Runner on it, and waits for all of them to finish.
+ * Every Runner sees the same image, so their results describe the same moment.
+ * @return The message returned by each Runner, in the order the Runners were given. Only valid until the next call.
+ */
+const std::vector<std::string> &ConfigExecutor::Iterate() {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    SharedFrame frame = Runner::TakeFrame(this->lastFrameId);
+    this->lastFrameId = frame.id;
+
+    if(this->pool) {
+        for(int i=0; i<this->results.size(); i++) {
+            this->pool->Submit(std::bind(&ConfigExecutor::RunConfig, this, i, frame));
+        }
+        this->pool->Wait();
+    } else {
+        for(int i=0; i<this->results.size(); i++) {
+            RunConfig(i, frame);
+        }
+    }
+
+    long micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    this->frameStats.frames++;
+    this->frameStats.totalMicros += micros;
+    this->frameStats.maxMicros = std::max(this->frameStats.maxMicros, micros);
+
+    return this->results;
+}
+
+/**
+ * Returns a human readable timing summary for each config and for the whole frame.
+ * Should only be called from the thread that calls Iterate().
+ */
+std::string ConfigExecutor::Summary() {
+    std::string summary = "";
+    for(int i=0; i<this->stats.size(); i++) {
+        ConfigStats configStats = this->stats[i];
+        double averageMillis = (configStats.frames > 0 ? configStats.totalMicros / (double) configStats.frames / 1000.0 : 0);
+        double maxMillis = configStats.maxMicros / 1000.0;
+        summary += this->runners[i].GetConfName() + ": " + std::to_string(averageMillis) + "ms avg, " + std::to_string(maxMillis) + "ms max\n";
+
+        double averageLatencyMillis = (configStats.capturedFrames > 0 ? configStats.totalLatencyMicros / (double) configStats.capturedFrames / 1000.0 : 0);
+        double maxLatencyMillis = configStats.maxLatencyMicros / 1000.0;
+        summary += "    capture to send: " + std::to_string(averageLatencyMillis) + "ms avg, " + std::to_string(maxLatencyMillis) + "ms max\n";
+
+        if(AllocationCounter::Enabled()) {
+            summary += "    " + std::to_string(configStats.lastAllocations) + " heap allocations last frame\n";
+        }
+
+        RegionTracker tracker = this->runners[i].GetRegionTracker();
+        if(tracker.Enabled()) {
+            summary += "    " + tracker.Summary() + "\n";
+        }
+
+        TargetTracker targetTracker = this->runners[i].GetTargetTracker();
+        if(targetTracker.Enabled()) {
+            summary += "    " + targetTracker.Summary() + "\n";
+        }
+    }
+
+    double frameAverageMillis = (this->frameStats.frames > 0 ? this->frameStats.totalMicros / (double) this->frameStats.frames / 1000.0 : 0);
+    double frameMaxMillis = this->frameStats.maxMicros / 1000.0;
+    summary += "frame: " + std::to_string(frameAverageMillis) + "ms avg, " + std::to_string(frameMaxMillis) + "ms max";
+    return summary;
+}
+
+/**
+ * Runs the Runner at "index" on "frame" and records how long it took.
+ */
+void ConfigExecutor::RunConfig(int index, SharedFrame frame) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    this->results[index] = this->runners[index].Iterate(frame);
+    long micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+    ConfigStats &configStats = this->stats[index];
+    configStats.frames++;
+    configStats.totalMicros += micros;
+    configStats.maxMicros = std::max(configStats.maxMicros, micros);
+    configStats.lastAllocations = this->runners[index].GetLastFrameAllocations();
+
+    if(this->runners[index].GetLastFrameSuccessful()) {
+        long latencyMicros = this->runners[index].GetLastFrameLatency();
+        configStats.capturedFrames++;
+        configStats.totalLatencyMicros += latencyMicros;
+        configStats.maxLatencyMicros = std::max(configStats.maxLatencyMicros, latencyMicros);
+    }
+}
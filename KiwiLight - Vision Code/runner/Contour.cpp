@@ -11,9 +11,8 @@ using namespace KiwiLight;
 /**
  * Creates a new contour object given the vector of points. 
  */
-Contour::Contour(std::vector<cv::Point> points) {
-    this->points = points;
-
+Contour::Contour(const std::vector<cv::Point> &points) {
+    //the points themselves are not kept, so Contours are cheap to copy.
     //find out the basic information of the contour
     cv::Rect boundingRect = cv::boundingRect(points);
     this->x = boundingRect.x;
@@ -31,4 +30,23 @@ Contour::Contour(std::vector<cv::Point> points) {
 
     int trueArea = cv::contourArea(points);
     this->solidity = trueArea / (double) this->Area();
-}
\ No newline at end of file
+}
+
+/**
+ * Creates a new contour object from features that were already measured.
+ * @param x The x coordinate of the contour's top-left corner.
+ * @param y The y coordinate of the contour's top-left corner.
+ * @param width The width of the contour's bounding box.
+ * @param height The height of the contour's bounding box.
+ * @param angle The contour's angle, in degrees.
+ * @param solidity The fraction of the bounding box the contour fills.
+ */
+Contour::Contour(int x, int y, int width, int height, int angle, double solidity) {
+    this->x = x;
+    this->y = y;
+    this->width = width;
+    this->height = height;
+    this->angle = angle;
+    this->solidity = solidity;
+    this->center = Point((width / 2) + x, (height / 2) + y);
+}
@@ -0,0 +1,82 @@
+#include "Runner.h"
+
+/**
+ * Source file for the ContourTable struct.
+ * Written By: Brach Knutson
+ */
+
+using namespace cv;
+using namespace KiwiLight;
+
+/**
+ * Removes every contour from the table. The columns keep their memory for the next frame.
+ */
+void ContourTable::Clear() {
+    this->x.clear();
+    this->y.clear();
+    this->width.clear();
+    this->height.clear();
+    this->angle.clear();
+    this->area.clear();
+    this->aspectRatio.clear();
+    this->solidity.clear();
+}
+
+/**
+ * Adds a row for "contour" to the end of the table.
+ */
+void ContourTable::Add(Contour contour) {
+    this->x.push_back(contour.X());
+    this->y.push_back(contour.Y());
+    this->width.push_back(contour.Width());
+    this->height.push_back(contour.Height());
+    this->angle.push_back(contour.Angle());
+    this->area.push_back(contour.Area());
+    this->aspectRatio.push_back(contour.AspectRatio());
+    this->solidity.push_back(contour.Solidity());
+}
+
+/**
+ * Returns the contour stored in "row".
+ */
+Contour ContourTable::Get(int row) {
+    return Contour(this->x[row], this->y[row], this->width[row], this->height[row], (int) this->angle[row], this->solidity[row]);
+}
+
+/**
+ * Returns the bounding box of a group of rows, measured the same way as Target::BoundsOf().
+ * @param rows The rows of the contours in the group.
+ * @param count The number of rows in the group.
+ */
+cv::Rect ContourTable::Bounds(const int *rows, int count) {
+    int biggestX = -5000;
+    int smallestX = 5000;
+    int biggestY = -5000;
+    int smallestY = 5000;
+
+    int biggestXWidth = 0;
+    int biggestYHeight = 0; 
+
+    for(int i=0; i<count; i++) {
+        int row = rows[i];
+        if(this->x[row] > biggestX) {
+            biggestX = this->x[row];
+            biggestXWidth = this->width[row];
+        } 
+        if(this->x[row] < smallestX) {
+            smallestX = this->x[row];
+        }
+
+        if(this->y[row] > biggestY) {
+            biggestY = this->y[row];
+            biggestYHeight = this->height[row];
+        }
+        if(this->y[row] < smallestY) {
+            smallestY = this->y[row];
+        }
+    }
+
+    int width = (biggestX - smallestX) + biggestXWidth;
+    int height = (biggestY - smallestY) + biggestYHeight;
+    return cv::Rect(smallestX, smallestY, width, height);
+}
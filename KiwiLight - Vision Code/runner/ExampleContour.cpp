@@ -64,6 +64,51 @@ bool ExampleContour::IsContour(Contour contour) {
     return (angleTest && arTest && solidTest && areaTest);
 }
 
+/**
+ * Runs IsContour() on every row of "table" at once. The loop has no branches, so the compiler can 
+ * turn it into vector instructions.
+ * @param table The contours to test.
+ * @param passed One value per row, set to 1 if the contour passed every test and 0 otherwise.
+ */
+void ExampleContour::TestContours(ContourTable &table, unsigned char *passed) {
+    const double
+        angleLower = this->angle.LowerBound(),
+        angleUpper = this->angle.UpperBound(),
+        arLower = this->aspectRatio.LowerBound(),
+        arUpper = this->aspectRatio.UpperBound(),
+        solidLower = this->solidity.LowerBound(),
+        solidUpper = this->solidity.UpperBound(),
+        minimumArea = this->minimumArea;
+
+    const double 
+        *angles = table.angle.data(),
+        *aspectRatios = table.aspectRatio.data(),
+        *solidities = table.solidity.data(),
+        *areas = table.area.data();
+
+    int rows = table.Size();
+    for(int i=0; i<rows; i++) {
+        passed[i] = (angles[i] > angleLower) & (angles[i] < angleUpper) &
+                    (aspectRatios[i] > arLower) & (aspectRatios[i] < arUpper) &
+                    (solidities[i] > solidLower) & (solidities[i] < solidUpper) &
+                    (areas[i] > minimumArea);
+    }
+}
+
+/**
+ * Runs only the tests that need nothing more than a bounding box (area and aspect ratio). 
+ * Used to throw out blobs before their angle and solidity are measured.
+ * @param width The width of the blob's bounding box.
+ * @param height The height of the blob's bounding box.
+ * @return False if a contour with that bounding box can not pass IsContour(), true if it might.
+ */
+bool ExampleContour::MightBeContour(int width, int height) {
+    double aspectRatio = width / (double) height;
+    bool arTest = (aspectRatio > this->aspectRatio.LowerBound() && aspectRatio < this->aspectRatio.UpperBound());
+    bool areaTest = (width * height > this->minimumArea);
+    return arTest && areaTest;
+}
+
 /**
  * Sets the value and allowable error of this ExampleContour's DistX property (target widths from contour center to target center, horizontally).
  */
@@ -8,6 +8,8 @@
 using namespace cv;
 using namespace KiwiLight;
 
+const int ExampleTarget::MAX_TARGETS = 5;
+
 /**
  * Creates a new ExampleTarget with given ExampleContours, to model a real target.
  */
@@ -27,148 +29,141 @@ ExampleTarget::ExampleTarget(
     this->distErrorCorrect = distErrorCorrect;
     this->calibratedDistance = calibratedDistance;
     this->distMode = distMode;
+    this->findBestGroups = TargetMatcher::BestGroupsFor(this->contours.size());
 }
 
 /**
- * returns a vector containing all targets found within the vector of contours.
+ * returns a vector containing the best targets found within the vector of contours. See the ContourTable version.
  */
-std::vector<Target> ExampleTarget::GetTargets(std::vector<Contour> objects) {
+std::vector<Target> ExampleTarget::GetTargets(const std::vector<Contour> &objects) {
+    ContourTable table;
+    for(int i=0; i<objects.size(); i++) {
+        table.Add(objects[i]);
+    }
 
-    std::vector<Target> foundTargets = std::vector<Target>();
-    std::vector<Contour> validContours = std::vector<Contour>();
-    
-    validContours = this->GetValidContours(objects);
-        
+    std::vector<Target> foundTargets;
+    FrameArena arena;
+    this->GetTargets(table, foundTargets, arena);
+    return foundTargets;
+}
+
+/**
+ * Finds the targets within the table of contours that fit this ExampleTarget best and stores them in "targets", best first.
+ * At most MAX_TARGETS targets are kept, and no two of them share a contour. Each target's Fit() is set.
+ * The Targets already in "targets" are reused, so a vector kept between frames stops allocating once it has grown.
+ * @param table The contours to search.
+ * @param targets Where to store the targets that were found.
+ * @param arena Where to keep lists that are only needed during the search. Must not be reset until this returns.
+ */
+void ExampleTarget::GetTargets(ContourTable &table, std::vector<Target> &targets, FrameArena &arena) {
+    //test every contour against every ExampleContour once, up front
+    ArenaVector<unsigned char> accepted = ArenaVector<unsigned char>(ArenaAllocator<unsigned char>(&arena));
+    ArenaVector<int> validContours = ArenaVector<int>(ArenaAllocator<int>(&arena));
+    this->TestContours(table, accepted, validContours);
+
+    //rows of the contours in each target that was found, one row per ExampleContour
+    ArenaVector<int> groups = ArenaVector<int>(ArenaAllocator<int>(&arena));
+    ArenaVector<double> fits = ArenaVector<double>(ArenaAllocator<double>(&arena));
+    TargetMatcher matcher = TargetMatcher(this->contours, table, accepted.data(), validContours.data(), validContours.size(), arena);
+    int numberFound = (matcher.*this->findBestGroups)(groups, fits, MAX_TARGETS);
     int numTargetContours = this->contours.size();
-    int numImageContours = validContours.size();
-
-    if(numTargetContours == 1) {
-        for(int i=0; i<numImageContours; i++) {
-            std::vector<Contour> potentialTarget = std::vector<Contour>();
-            potentialTarget.push_back(validContours[i]);
-            if(isTarget(potentialTarget)) {
-                Target newTarg = Target(this->id, potentialTarget, this->knownHeight, this->focalHeight, this->distErrorCorrect, this->calibratedDistance, this->distMode);
-                foundTargets.push_back(newTarg);
-            }
-        }
-    } 
-    else {
-        int places[(const int) numTargetContours] = {};
-        for(int i=0; i<numTargetContours; i++) {
-            places[i] = 0;
+
+    for(int i=0; i<numberFound; i++) {
+        if(i == targets.size()) {
+            targets.push_back(Target());
         }
 
-        std::vector< std::vector<int> > originalCombos;
-
-        //while new combos are possible, generate and test combos of targets
-        while(!ArrayMaxed(places, numTargetContours, numImageContours)) {
-            if(!ContainsDuplicates(places, numTargetContours)) {
-                if(!CombonationAlreadyTested(places, originalCombos, numTargetContours)) {
-                    //add to original combos and then test;
-
-                    //we create new vector to protect it from being changed in the vector
-                    std::vector<int> newOriginalCombo;
-
-                    for(int i=0; i<numTargetContours; i++) {
-                        newOriginalCombo.push_back(places[i]);
-                    }
-                    originalCombos.push_back(newOriginalCombo);
-
-                    //the testing part
-                    std::vector<Contour> potentialTarget = std::vector<Contour>();
-                    for(int i=0; i<numTargetContours; i++) {
-                        int index = places[i];
-                        potentialTarget.push_back(validContours[index]);
-                    }
-
-                    //test new target
-                    if(isTarget(potentialTarget)) {
-                        Target newTarget = Target(this->id, potentialTarget, this->knownHeight, this->focalHeight, this->distErrorCorrect, this->calibratedDistance, this->distMode);
-                        foundTargets.push_back(newTarget);
-                    }
-                }
-            }
+        targets[i].Set(this->id, table, &groups[i * numTargetContours], numTargetContours, this->knownHeight, this->focalHeight, this->distErrorCorrect, this->calibratedDistance, this->distMode);
+        targets[i].SetFit(fits[i]);
+    }
 
-            //calculate the next combo of contours
-            for(int i=0; i<numTargetContours; i++) {
-                places[i]++;
+    targets.resize(numberFound);
+}
+
+/**
+ * Given the vector of contours, returns whether the contours could be a target(true) or not(false).
+ * The contours can be in any order; each one just has to fit a different ExampleContour.
+ * precondition: objects.size() == this->contours.size();
+ */
+bool ExampleTarget::isTarget(const std::vector<Contour> &objects) {
+    FrameArena arena;
+    ContourTable table;
+    for(int i=0; i<objects.size(); i++) {
+        table.Add(objects[i]);
+    }
 
-                if(i > 0) {
-                    places[i-1] = 0;
-                }
+    ArenaVector<unsigned char> accepted = ArenaVector<unsigned char>(ArenaAllocator<unsigned char>(&arena));
+    ArenaVector<int> validRows = ArenaVector<int>(ArenaAllocator<int>(&arena));
+    this->TestContours(table, accepted, validRows);
 
-                if(places[i] < numImageContours) {
-                    break;
-                }  
+    ArenaVector<int> groups = ArenaVector<int>(ArenaAllocator<int>(&arena));
+    ArenaVector<double> fits = ArenaVector<double>(ArenaAllocator<double>(&arena));
+    TargetMatcher matcher = TargetMatcher(this->contours, table, accepted.data(), validRows.data(), validRows.size(), arena);
+    return matcher.FindGroups<0>(groups, fits) > 0;
+}
+
+/**
+ * Tests every row of "table" against every ExampleContour in one batch.
+ * @param table The contours to test.
+ * @param accepted Filled with one value per ExampleContour per row. accepted[(k * rows) + row] is 1 if ExampleContour k accepts "row".
+ * @param validRows Filled with the rows that at least one ExampleContour accepts, in order.
+ */
+void ExampleTarget::TestContours(ContourTable &table, ArenaVector<unsigned char> &accepted, ArenaVector<int> &validRows) {
+    int rows = table.Size();
+    accepted.resize(this->contours.size() * rows);
+    for(int k=0; k<this->contours.size(); k++) {
+        this->contours[k].TestContours(table, accepted.data() + (k * rows));
+    }
+
+    validRows.clear();
+    for(int i=0; i<rows; i++) {
+        for(int k=0; k<this->contours.size(); k++) {
+            if(accepted[(k * rows) + i]) {
+                validRows.push_back(i);
+                break;
             }
         }
     }
-
-    return foundTargets;
 }
 
 /**
- * Given the vector of contours, returns whether the contours could be a target(true) or not(false).
- * precondition: objects.size() == this->contours.size();
+ * Returns true if a blob with the given bounding box might be one of this target's contours, using only 
+ * the cheap area and aspect ratio tests.
  */
-bool ExampleTarget::isTarget(std::vector<Contour> objects) {
-    /**
-     * Determine if the passed vector of contours is a target or not by comparing the 
-     * distances from the center of the target in target widths.
-     * if a contour passes, it is removed from the array.
-     * if the array is empty by the end of the method, return true
-     */
-
-    std::vector<Contour> imageContours = objects;
-    std::vector<ExampleContour> targetContours = this->contours;
-
-    int totalGood = 0;
-
-    Target potentialTarg = Target(0, imageContours, 0, 0, 0, 0, this->distMode);
-    int centerX = potentialTarg.Center().x;
-    int centerY = potentialTarg.Center().y;
-    
-    int objectWidth = potentialTarg.Bounds().width;
-
-    for(int i=0; i<imageContours.size(); i++) {
-        Contour object = imageContours[i];
-        //determine how many widths to the center for the object and compare to our targets
-        int distToCenterX = centerX - object.Center().x;
-        double widthsToCenterX = distToCenterX / (double) objectWidth;
-
-        int distToCenterY = centerY - object.Center().y;
-        double widthsToCenterY = (double) distToCenterY / (double) objectWidth;
-        for(int k=0; k<targetContours.size(); k++) {
-            //measure distance in pixels, convert to widths, and compare to exampleContours.
-            bool distXValid = (widthsToCenterX > targetContours[k].DistX().LowerBound() &&
-                               widthsToCenterX < targetContours[k].DistX().UpperBound() );
-
-            bool distYValid = (widthsToCenterY > targetContours[k].DistY().LowerBound() &&
-                               widthsToCenterY < targetContours[k].DistY().UpperBound() );
-                               
-            if(distXValid && distYValid && targetContours[k].IsContour(imageContours[i])) {
-                totalGood++;
-            }
+bool ExampleTarget::MightHaveContour(int width, int height) {
+    for(int i=0; i<this->contours.size(); i++) {
+        if(this->contours[i].MightBeContour(width, height)) {
+            return true;
         }
+    }
 
+    return false;
+}
+
+/**
+ * Filters out contours that are definitely NOT part of this target.
+ */
+std::vector<Contour> ExampleTarget::GetValidContours(const std::vector<Contour> &objects) {
+    ContourTable table;
+    for(int i=0; i<objects.size(); i++) {
+        table.Add(objects[i]);
     }
-    
-    return (this->contours.size() == totalGood);
+
+    return this->GetValidContours(table);
 }
 
 /**
  * Filters out contours that are definitely NOT part of this target.
  */
-std::vector<Contour> ExampleTarget::GetValidContours(std::vector<Contour> objects) {
+std::vector<Contour> ExampleTarget::GetValidContours(ContourTable &table) {
+    FrameArena arena;
+    ArenaVector<unsigned char> accepted = ArenaVector<unsigned char>(ArenaAllocator<unsigned char>(&arena));
+    ArenaVector<int> validRows = ArenaVector<int>(ArenaAllocator<int>(&arena));
+    this->TestContours(table, accepted, validRows);
+
     std::vector<Contour> validContours;
-    
-    for(int i=0; i<objects.size(); i++) {
-        for(int k=0; k<this->contours.size(); k++) {
-            if(this->contours[k].IsContour(objects[i])) {
-                validContours.push_back(objects[i]);
-                break;
-            }
-        }
+    for(int i=0; i<validRows.size(); i++) {
+        validContours.push_back(table.Get(validRows[i]));
     }
     
     return validContours;
@@ -324,6 +319,39 @@ double ExampleTarget::GetTargetProperty(RunnerProperty prop) {
     return value;
 }
 
+/**
+ * Encodes this ExampleTarget into a <target> tag, in the same form that configuration files store it.
+ */
+XMLTag ExampleTarget::EncodeXMLTag() {
+    XMLTag tag = XMLTag("target");
+    tag.AddAttribute(XMLTagAttribute("id", std::to_string(this->id)));
+
+    for(int i=0; i<this->contours.size(); i++) {
+        ExampleContour contour = this->contours[i];
+        XMLTag contourTag = XMLTag("contour");
+        contourTag.AddAttribute(XMLTagAttribute("id", std::to_string(contour.ID())));
+
+        //every property but the minimum area is a value with an allowed error
+        std::string names[] = { "x", "y", "angle", "solidity", "aspectRatio" };
+        SettingPair values[] = { contour.DistX(), contour.DistY(), contour.Angle(), contour.Solidity(), contour.AspectRatio() };
+        for(int k=0; k<5; k++) {
+            XMLTag property = XMLTag(names[k], std::to_string((double) values[k].Value()));
+            property.AddAttribute(XMLTagAttribute("error", std::to_string((double) values[k].Error())));
+            contourTag.AddTag(property);
+        }
+
+        contourTag.AddTag(XMLTag("minimumArea", std::to_string(contour.MinimumArea())));
+        tag.AddTag(contourTag);
+    }
+
+    tag.AddTag(XMLTag("knownWidth", std::to_string(this->knownHeight)));
+    tag.AddTag(XMLTag("focalWidth", std::to_string(this->focalHeight)));
+    tag.AddTag(XMLTag("calibratedDistance", std::to_string(this->calibratedDistance)));
+    tag.AddTag(XMLTag("distErrorCorrect", std::to_string(this->distErrorCorrect)));
+    tag.AddTag(XMLTag("calcByHeight", (this->distMode == DistanceCalcMode::BY_HEIGHT ? "true" : "false")));
+    return tag;
+}
+
 /**
  * Adds a "generic" contour to this target, increasing the contour count by 1.
  * DEPRECATED: This method is no longer used and will be removed in the next update.
@@ -337,62 +365,5 @@ void ExampleTarget::AddGenericContour() {
 
     ExampleContour newContour = ExampleContour(this->contours.size(), genericDistX, genericDistY, genericAngle, genericAspectRatio, genericSolidity, 1000);
     this->contours.push_back(newContour);
-}
-
-/**
- * Returns true if arr as any possible combos left based on the values "size" and "max," false otherwise.
- */
-bool ExampleTarget::ArrayMaxed(int arr[], int size, int max) {
-    if(arr[size - 1] < max) {
-        return false;
-    }
-
-    return true;
-}
-
-/**
- * Returns true if arr contains duplicate values, false otherwise.
- */
-bool ExampleTarget::ContainsDuplicates(int arr[], int size) {
-    for(int i=0; i<size; i++) {
-        for(int k=0; k<size; k++) {
-            if(i != k && arr[i] == arr[k]) {
-                //thats a duplicate
-                return true;
-            }
-        }
-    }
-}
-
-/**
- * Evaluates whether "combo" matches any combonations present in "testedCombos."
- * @param combo An int array representing the combonation to be tested.
- * @param testedCombos A vector of combos which have already been tested.
- * @param comboSize The length of the combo array (numbers, not bytes! DO NOT use sizeof()!)
- */
-bool ExampleTarget::CombonationAlreadyTested(int combo[], std::vector< std::vector<int> > testedCombos, int comboSize) {    
-    for(int i=0; i<testedCombos.size(); i++) {
-        std::vector<int> originalCombo = testedCombos[i];
-        int matchingNumbers = 0;
-
-        //compare all numbers between the two arrays
-        for(int x=0; x<comboSize; x++) {
-            int numberToTest = combo[x];
-
-            for(int y=0; y<comboSize; y++) {
-                int originalNumber = originalCombo[y];
-
-                if(numberToTest == originalNumber) {
-                    matchingNumbers++;
-                }   
-            }
-        }
-
-        //if all numbers in the combo match, then "combo" is not original, therefore return true.
-        if(matchingNumbers == comboSize) {
-            return true;
-        }
-    }
-
-    return false;
+    this->findBestGroups = TargetMatcher::BestGroupsFor(this->contours.size());
 }
@@ -0,0 +1,34 @@
+#include "Runner.h"
+
+/**
+ * Source file for the FileFrameSource class.
+ * Written By: Brach Knutson
+ */
+
+using namespace cv;
+using namespace KiwiLight;
+
+/**
+ * Creates a new FileFrameSource.
+ */
+FileFrameSource::FileFrameSource() {
+    this->lastFrameId = -1;
+}
+
+/**
+ * Returns the current frame if it is newer than "afterId", otherwise reads the next one once every consumer 
+ * has taken the current one. This way, every consumer sees every frame. This method may be called from multiple threads.
+ * @param afterId The id of the last frame the caller processed.
+ * @return The frame, which is invalid once every frame has been read.
+ */
+SharedFrame FileFrameSource::Next(long afterId) {
+    return this->frame.Next(afterId, [this](SharedFrame &next) {
+        cv::Mat image = ReadFrame();
+        if(image.empty()) {
+            return false;
+        }
+
+        next = SharedFrame(++this->lastFrameId, image, LastFrameTimestamp());
+        return true;
+    });
+}
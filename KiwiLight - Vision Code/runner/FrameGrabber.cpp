@@ -0,0 +1,138 @@
+#include "Runner.h"
+
+/**
+ * Source file for the FrameGrabber class.
+ * Written By: Brach Knutson
+ */
+
+using namespace cv;
+using namespace KiwiLight;
+
+const int FrameGrabber::STALE_FRAME_WAIT_MS = 100;
+
+/**
+ * Creates a new FrameGrabber. The grabber does nothing until Start() is called.
+ */
+FrameGrabber::FrameGrabber() {
+    this->camera = nullptr;
+    this->running.store(false);
+    this->captureFailures.store(0);
+}
+
+/**
+ * Stops the capture thread if it is still running.
+ */
+FrameGrabber::~FrameGrabber() {
+    Stop();
+}
+
+/**
+ * Starts capturing frames from "camera" on a separate thread.
+ * The camera must not be used by anything else until Stop() is called.
+ */
+void FrameGrabber::Start(VideoCapture *camera) {
+    if(this->running.load()) {
+        return;
+    }
+
+    this->camera = camera;
+    this->running.store(true);
+    this->captureThread = std::thread(&FrameGrabber::CaptureLoop, this);
+}
+
+/**
+ * Stops the capture thread and waits for it to finish.
+ */
+void FrameGrabber::Stop() {
+    this->running.store(false);
+    if(this->captureThread.joinable()) {
+        this->captureThread.join();
+    }
+}
+
+/**
+ * Copies the newest captured frame into "frame". If no new frame has arrived since the last call, 
+ * waits up to STALE_FRAME_WAIT_MS for one before handing back the previous frame again.
+ * This method may be called from multiple threads.
+ * @param frame The Mat to copy the frame into. Its buffer is reused when the size matches.
+ * @return True if "frame" contains an image, false otherwise.
+ */
+bool FrameGrabber::Latest(cv::Mat &frame) {
+    //no frame id is newer than LONG_MAX, so this always asks for a new frame
+    SharedFrame shared = Shared(LONG_MAX);
+    if(!shared.Valid()) {
+        return false;
+    }
+
+    shared.image->copyTo(frame);
+    return true;
+}
+
+/**
+ * Returns the newest captured frame, which is shared with every other caller instead of being copied for each.
+ * If the newest frame is not newer than "afterId", waits up to STALE_FRAME_WAIT_MS for one before 
+ * handing back the newest frame again. This method may be called from multiple threads.
+ * @param afterId The id of the last frame the caller processed.
+ * @return The newest frame. It is invalid if nothing has been captured yet.
+ */
+SharedFrame FrameGrabber::Shared(long afterId) {
+    std::lock_guard<std::mutex> consumerGuard(this->consumerLock);
+
+    if(this->newest.id <= afterId) {
+        std::unique_lock<std::mutex> frameGuard(this->frameLock);
+        this->frameReady.wait_for(frameGuard, std::chrono::milliseconds(STALE_FRAME_WAIT_MS), [this] {
+            return this->ring.HasNewFrame() || !this->running.load();
+        });
+    }
+
+    //callers that are already behind take the newest frame without counting it as a duplicate
+    if(this->ring.HasNewFrame() || this->newest.id <= afterId) {
+        cv::Mat image;
+        this->ring.Acquire(image);
+
+        //the ring reuses its buffers, so the shared frame needs its own copy. It goes into a pooled buffer, 
+        //so no memory is allocated once every buffer in use has been created
+        if(!image.empty() && this->ring.Sequence() != this->newest.id) {
+            this->newest = this->framePool.Copy(this->ring.Sequence(), image, this->ring.Timestamp());
+        }
+    }
+
+    return this->newest;
+}
+
+/**
+ * Returns a short summary of the grabber's frame counters.
+ */
+std::string FrameGrabber::Summary() {
+    return std::string("captured: ")   + std::to_string(FramesCaptured()) +
+           std::string(", dropped: ")    + std::to_string(FramesDropped()) +
+           std::string(", duplicated: ") + std::to_string(FramesDuplicated()) +
+           std::string(", failures: ")   + std::to_string(CaptureFailures());
+}
+
+/**
+ * Grabs frames nonstop until Stop() is called.
+ */
+void FrameGrabber::CaptureLoop() {
+    while(this->running.load()) {
+        cv::Mat &buffer = this->ring.WriteBuffer();
+        bool success = this->camera->grab();
+        long long timestamp = Clock::GetMonotonicTime(); //grab() returns right after the camera hands over the frame
+        if(success) {
+            success = this->camera->retrieve(buffer);
+        }
+
+        if(success && !buffer.empty()) {
+            this->ring.Publish(timestamp);
+
+            //briefly take the lock so a consumer can't miss the wakeup between checking and waiting
+            { std::lock_guard<std::mutex> frameGuard(this->frameLock); }
+            this->frameReady.notify_all();
+        } else {
+            this->captureFailures++;
+            usleep(5000); //give the camera some time before trying again
+        }
+    }
+
+    this->frameReady.notify_all();
+}
@@ -0,0 +1,246 @@
+#include "Runner.h"
+
+/**
+ * Source file for the FrameRecorder class.
+ * Written By: Brach Knutson
+ */
+
+using namespace cv;
+using namespace KiwiLight;
+
+const int      FrameRecorder::DEFAULT_QUEUE_DEPTH = 32;
+const int      FrameRecorder::CHUNK_FRAMES        = 16;
+const char     FrameRecorder::FILE_MAGIC[8]       = { 'K', 'L', 'R', 'A', 'W', '0', '0', '1' };
+const char     FrameRecorder::INDEX_MAGIC[8]      = { 'K', 'L', 'I', 'D', 'X', '0', '0', '1' };
+const uint32_t FrameRecorder::CHUNK_MAGIC         = 0x4B4C4348; //"KLCH"
+
+/**
+ * Creates a new FrameRecorder and starts its writer thread. If the recording already exists, new frames are appended to it 
+ * as a new session.
+ * @param source The source to take frames from.
+ * @param fileName The path of the recording. The index is written next to it.
+ * @param queueDepth The number of frames that may wait to be written before frames are dropped.
+ */
+FrameRecorder::FrameRecorder(std::shared_ptr<FrameSource> source, std::string fileName, int queueDepth)
+ : unwritten(queueDepth) {
+    this->source = source;
+    this->fileName = fileName;
+    this->lastRecordedId = -1;
+    this->framesWritten.store(0);
+    this->framesDropped.store(0);
+    this->session = 0;
+    this->writing.store(false);
+
+    if(!Resume()) {
+        return;
+    }
+
+    std::string indexFileName = fileName + ".idx";
+    std::ifstream existingIndex(indexFileName, std::ios::binary | std::ios::ate);
+    bool indexEmpty = (!existingIndex.is_open() || existingIndex.tellg() == 0);
+
+    this->recordingFile.open(fileName, std::ios::binary | std::ios::app);
+    this->indexFile.open(indexFileName, std::ios::binary | std::ios::app);
+    this->writing.store(this->recordingFile.is_open() && this->indexFile.is_open());
+    if(!this->writing.load()) {
+        std::cout << "WARNING: The recording \"" << fileName << "\" could not be opened! Frames will not be recorded." << std::endl;
+        return;
+    }
+
+    if(this->recordingSize == 0) {
+        this->recordingFile.write(FILE_MAGIC, sizeof(FILE_MAGIC));
+        this->recordingSize = sizeof(FILE_MAGIC);
+    }
+
+    if(indexEmpty) {
+        this->indexFile.write(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    }
+
+    this->writeThread = std::thread(&FrameRecorder::WriteLoop, this);
+}
+
+/**
+ * Gets an existing recording ready to be appended to, and picks the session to write.
+ * A chunk that was cut short is cut off, so the chunks of the new session follow the last complete one. 
+ * @return True if frames can be recorded, false if the file is something other than a recording of this version.
+ */
+bool FrameRecorder::Resume() {
+    std::string indexFileName = this->fileName + ".idx";
+    std::ifstream existingRecording(this->fileName, std::ios::binary | std::ios::ate);
+    this->recordingSize = (existingRecording.is_open() ? (uint64_t) existingRecording.tellg() : 0);
+    existingRecording.close();
+
+    //a file that stops inside FILE_MAGIC never held a frame, so it is started over. Its index may not exist yet
+    if(this->recordingSize < sizeof(FILE_MAGIC)) {
+        if(this->recordingSize > 0) {
+            bool startedOver = 
+                truncate(this->fileName.c_str(), 0) == 0 &&
+                (truncate(indexFileName.c_str(), 0) == 0 || errno == ENOENT);
+
+            if(!startedOver) {
+                std::cout << "WARNING: The recording \"" << this->fileName << "\" could not be started over! Frames will not be recorded." << std::endl;
+                return false;
+            }
+        }
+
+        this->recordingSize = 0;
+        return true;
+    }
+
+    FrameRecording existing(this->fileName);
+    if(!existing.IsOpen()) {
+        std::cout << "WARNING: Frames will not be recorded to \"" << this->fileName << "\". Record to a new file instead." << std::endl;
+        return false;
+    }
+
+    this->session = existing.LastSession() + 1;
+    if(existing.CompleteSize() < this->recordingSize) {
+        std::cout << "Cutting " << (this->recordingSize - existing.CompleteSize()) << " bytes of an unfinished chunk off the end of \"" << this->fileName << "\"" << std::endl;
+        if(truncate(this->fileName.c_str(), existing.CompleteSize()) != 0) {
+            std::cout << "WARNING: The recording \"" << this->fileName << "\" could not be cut! Frames will not be recorded." << std::endl;
+            return false;
+        }
+
+        this->recordingSize = existing.CompleteSize();
+    }
+
+    //new entries are appended to the index, so it has to cover everything before them
+    if(existing.IndexRebuilt() && !existing.SaveIndex(indexFileName)) {
+        std::cout << "WARNING: The index of \"" << this->fileName << "\" could not be rewritten! Frames will not be recorded." << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Writes the frames that are still waiting and closes the recording.
+ */
+FrameRecorder::~FrameRecorder() {
+    Stop();
+}
+
+/**
+ * Takes the next frame from the source, and queues it to be written if it has not been recorded yet.
+ * Never waits for the writer. This method may be called from multiple threads.
+ * @param afterId The id of the last frame the caller processed.
+ */
+SharedFrame FrameRecorder::Next(long afterId) {
+    SharedFrame frame = this->source->Next(afterId);
+    if(!this->writing.load() || !frame.Valid()) {
+        return frame;
+    }
+
+    std::lock_guard<std::mutex> lock(this->recordLock);
+    if(frame.id > this->lastRecordedId) {
+        this->lastRecordedId = frame.id;
+
+        //only the writer makes room in the queue, so a queue that isn't full can't fill up before the push
+        if(this->unwritten.Size() < this->unwritten.Capacity()) {
+            this->unwritten.Push(frame);
+        } else {
+            this->framesDropped++;
+        }
+    }
+
+    return frame;
+}
+
+/**
+ * Stops accepting frames, writes the frames that are still waiting, and waits for the writer to finish.
+ */
+void FrameRecorder::Stop() {
+    this->unwritten.Close();
+    if(this->writeThread.joinable()) {
+        this->writeThread.join();
+    }
+}
+
+/**
+ * Returns a short summary of the recorder's frame counters.
+ */
+std::string FrameRecorder::Summary() {
+    return std::string("recorded: ") + std::to_string(FramesWritten()) +
+           std::string(", dropped: ")  + std::to_string(FramesDropped());
+}
+
+/**
+ * Writes frames in chunks as they arrive until stopped. A chunk holds whatever frames are waiting, 
+ * up to CHUNK_FRAMES, so frames are never held back to fill a chunk.
+ */
+void FrameRecorder::WriteLoop() {
+    SharedFrame frame;
+    std::vector<SharedFrame> chunk;
+    while(this->unwritten.Pop(frame)) {
+        chunk.clear();
+        chunk.push_back(frame);
+        while(chunk.size() < CHUNK_FRAMES && this->unwritten.Size() > 0 && this->unwritten.Pop(frame)) {
+            chunk.push_back(frame);
+        }
+
+        if(!WriteChunk(chunk)) {
+            this->framesDropped += chunk.size();
+        }
+    }
+}
+
+/**
+ * Appends "chunk" to the recording, then appends its frames to the index. The recording is flushed first 
+ * so that the index never points at frames that were not written.
+ * @return True if the chunk was written, false otherwise.
+ */
+bool FrameRecorder::WriteChunk(std::vector<SharedFrame> &chunk) {
+    RecordingChunkHeader chunkHeader;
+    chunkHeader.magic = CHUNK_MAGIC;
+    chunkHeader.frames = chunk.size();
+    chunkHeader.session = this->session;
+    chunkHeader.reserved = 0;
+    chunkHeader.bytes = 0;
+    for(int i=0; i<chunk.size(); i++) {
+        const cv::Mat &image = *chunk[i].image;
+        chunkHeader.bytes += sizeof(RecordingFrameHeader) + (uint64_t) image.rows * image.cols * image.elemSize();
+    }
+
+    this->recordingFile.write((const char*) &chunkHeader, sizeof(chunkHeader));
+
+    std::vector<RecordingIndexEntry> entries;
+    uint64_t offset = this->recordingSize + sizeof(chunkHeader);
+    for(int i=0; i<chunk.size(); i++) {
+        const cv::Mat &image = *chunk[i].image;
+        RecordingFrameHeader frameHeader;
+        frameHeader.timestamp = chunk[i].timestamp;
+        frameHeader.id = chunk[i].id;
+        frameHeader.rows = image.rows;
+        frameHeader.cols = image.cols;
+        frameHeader.type = image.type();
+        frameHeader.rowBytes = image.cols * image.elemSize();
+
+        this->recordingFile.write((const char*) &frameHeader, sizeof(frameHeader));
+        for(int r=0; r<image.rows; r++) {
+            this->recordingFile.write((const char*) image.ptr(r), frameHeader.rowBytes);
+        }
+
+        RecordingIndexEntry entry;
+        entry.timestamp = frameHeader.timestamp;
+        entry.offset = offset;
+        entry.session = this->session;
+        entry.reserved = 0;
+        entries.push_back(entry);
+        offset += sizeof(frameHeader) + (uint64_t) frameHeader.rows * frameHeader.rowBytes;
+    }
+
+    this->recordingFile.flush();
+    if(!this->recordingFile.good()) {
+        if(this->writing.exchange(false)) {
+            std::cout << "WARNING: Writing to the recording \"" << this->fileName << "\" failed! No more frames will be recorded." << std::endl;
+        }
+
+        return false;
+    }
+
+    this->recordingSize = offset;
+    this->indexFile.write((const char*) entries.data(), entries.size() * sizeof(RecordingIndexEntry));
+    this->indexFile.flush();
+    this->framesWritten += chunk.size();
+    return true;
+}
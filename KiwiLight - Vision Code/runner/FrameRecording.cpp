@@ -0,0 +1,178 @@
+#include "Runner.h"
+
+/**
+ * Source file for the FrameRecording class.
+ * Written By: Brach Knutson
+ */
+
+using namespace cv;
+using namespace KiwiLight;
+
+/**
+ * Opens the raw recording at "fileName" and loads its index.
+ */
+FrameRecording::FrameRecording(std::string fileName) {
+    this->recordingSize = 0;
+    this->completeSize = 0;
+    this->indexRebuilt = false;
+    this->recordingFile.open(fileName, std::ios::binary | std::ios::ate);
+    if(!this->recordingFile.is_open()) {
+        std::cout << "WARNING: The recording \"" << fileName << "\" could not be opened!" << std::endl;
+        return;
+    }
+
+    this->recordingSize = this->recordingFile.tellg();
+    char magic[sizeof(FrameRecorder::FILE_MAGIC)];
+    this->recordingFile.seekg(0);
+    this->recordingFile.read(magic, sizeof(magic));
+    if(!this->recordingFile.good() || memcmp(magic, FrameRecorder::FILE_MAGIC, sizeof(magic)) != 0) {
+        std::cout << "WARNING: \"" << fileName << "\" is not a KiwiLight recording!" << std::endl;
+        this->recordingFile.close();
+        return;
+    }
+
+    if(!LoadIndex(fileName + ".idx")) {
+        std::cout << "The index of \"" << fileName << "\" is missing or incomplete. Rebuilding it." << std::endl;
+        RebuildIndex();
+        this->indexRebuilt = true;
+    }
+}
+
+/**
+ * Returns the first frame of "session" that was captured at or after "timestamp", or the first frame of the next 
+ * session if there is none. Timestamps are only compared within a session, because they start over when the 
+ * recording machine restarts.
+ */
+int FrameRecording::Seek(int session, long long timestamp) {
+    RecordingIndexEntry target;
+    target.session = session;
+    target.timestamp = timestamp;
+    std::vector<RecordingIndexEntry>::iterator found = std::lower_bound(this->entries.begin(), this->entries.end(), target, 
+        [] (const RecordingIndexEntry &a, const RecordingIndexEntry &b) { 
+            return (a.session != b.session ? a.session < b.session : a.timestamp < b.timestamp); 
+        });
+
+    return found - this->entries.begin();
+}
+
+/**
+ * Writes the index of the recording to "indexFileName", replacing what was there.
+ * @return True if the index was written, false otherwise.
+ */
+bool FrameRecording::SaveIndex(std::string indexFileName) {
+    std::ofstream indexFile(indexFileName, std::ios::binary | std::ios::trunc);
+    indexFile.write(FrameRecorder::INDEX_MAGIC, sizeof(FrameRecorder::INDEX_MAGIC));
+    indexFile.write((const char*) this->entries.data(), this->entries.size() * sizeof(RecordingIndexEntry));
+    indexFile.flush();
+    return indexFile.good();
+}
+
+/**
+ * Reads a frame of the recording into "image".
+ * @param frame The number of the frame to read.
+ * @param image The Mat to read into. Its buffer is reused when the size and type match.
+ * @return True if the frame was read, false otherwise.
+ */
+bool FrameRecording::Read(int frame, cv::Mat &image) {
+    if(frame < 0 || frame >= this->entries.size()) {
+        return false;
+    }
+
+    RecordingFrameHeader header;
+    this->recordingFile.clear();
+    this->recordingFile.seekg(this->entries[frame].offset);
+    this->recordingFile.read((char*) &header, sizeof(header));
+    if(!this->recordingFile.good()) {
+        return false;
+    }
+
+    image.create(header.rows, header.cols, header.type);
+    for(int r=0; r<header.rows; r++) {
+        this->recordingFile.read((char*) image.ptr(r), header.rowBytes);
+    }
+
+    return this->recordingFile.good();
+}
+
+/**
+ * Loads the index written next to the recording.
+ * @return True if the index was loaded and covers the whole recording, false otherwise.
+ */
+bool FrameRecording::LoadIndex(std::string indexFileName) {
+    std::ifstream indexFile(indexFileName, std::ios::binary | std::ios::ate);
+    uint64_t indexSize = (indexFile.is_open() ? (uint64_t) indexFile.tellg() : 0);
+    char magic[sizeof(FrameRecorder::INDEX_MAGIC)];
+    indexFile.seekg(0);
+    indexFile.read(magic, sizeof(magic));
+    if(!indexFile.good() || memcmp(magic, FrameRecorder::INDEX_MAGIC, sizeof(magic)) != 0) {
+        return false;
+    }
+
+    //an entry cut short would throw off every entry appended after it
+    if((indexSize - sizeof(magic)) % sizeof(RecordingIndexEntry) != 0) {
+        return false;
+    }
+
+    RecordingIndexEntry entry;
+    while(indexFile.read((char*) &entry, sizeof(entry))) {
+        this->entries.push_back(entry);
+    }
+
+    //the recording is flushed before the index, so a crash can leave frames that are not in the index yet
+    uint64_t indexedSize = sizeof(FrameRecorder::FILE_MAGIC);
+    if(this->entries.size() > 0) {
+        RecordingFrameHeader header;
+        this->recordingFile.seekg(this->entries.back().offset);
+        this->recordingFile.read((char*) &header, sizeof(header));
+        if(!this->recordingFile.good()) {
+            this->recordingFile.clear();
+            return false;
+        }
+
+        indexedSize = this->entries.back().offset + sizeof(header) + (uint64_t) header.rows * header.rowBytes;
+    }
+
+    this->completeSize = indexedSize;
+    return indexedSize == this->recordingSize;
+}
+
+/**
+ * Rebuilds the index by walking the chunks of the recording. A chunk that was cut short, such as 
+ * by a crash while it was being written, ends the recording. FrameRecorder cuts such a chunk off 
+ * before appending, so one can only be the last.
+ */
+void FrameRecording::RebuildIndex() {
+    this->entries.clear();
+    this->recordingFile.clear();
+
+    uint64_t chunkOffset = sizeof(FrameRecorder::FILE_MAGIC);
+    RecordingChunkHeader chunkHeader;
+    while(chunkOffset + sizeof(chunkHeader) <= this->recordingSize) {
+        this->recordingFile.seekg(chunkOffset);
+        this->recordingFile.read((char*) &chunkHeader, sizeof(chunkHeader));
+        uint64_t chunkEnd = chunkOffset + sizeof(chunkHeader) + chunkHeader.bytes;
+        if(!this->recordingFile.good() || chunkHeader.magic != FrameRecorder::CHUNK_MAGIC || chunkEnd > this->recordingSize) {
+            break;
+        }
+
+        uint64_t frameOffset = chunkOffset + sizeof(chunkHeader);
+        for(int i=0; i<chunkHeader.frames; i++) {
+            RecordingFrameHeader frameHeader;
+            this->recordingFile.seekg(frameOffset);
+            this->recordingFile.read((char*) &frameHeader, sizeof(frameHeader));
+
+            RecordingIndexEntry entry;
+            entry.timestamp = frameHeader.timestamp;
+            entry.offset = frameOffset;
+            entry.session = chunkHeader.session;
+            entry.reserved = 0;
+            this->entries.push_back(entry);
+            frameOffset += sizeof(frameHeader) + (uint64_t) frameHeader.rows * frameHeader.rowBytes;
+        }
+
+        chunkOffset = chunkEnd;
+    }
+
+    this->completeSize = chunkOffset;
+    this->recordingFile.clear();
+}
@@ -0,0 +1,38 @@
+#include "Runner.h"
+
+/**
+ * Source file for the FrameSource class.
+ * Written By: Brach Knutson
+ */
+
+using namespace cv;
+using namespace KiwiLight;
+
+const int FrameSource::DEFAULT_PRELOAD_DEPTH = 8;
+
+/**
+ * Creates the FrameSource described by "description". File sources are preloaded on a background thread.
+ * @param description One of "camera", "video:<file>", "images:<directory or image file>", or "raw:<recording>".
+ * @return The new source, or nullptr if the description is not recognized.
+ */
+std::shared_ptr<FrameSource> FrameSource::Create(std::string description) {
+    size_t colon = description.find(':');
+    std::string 
+        type = description.substr(0, colon),
+        path = (colon == std::string::npos ? "" : description.substr(colon + 1));
+
+    std::shared_ptr<FrameSource> source;
+    if(type == "camera") {
+        return std::shared_ptr<FrameSource>(new CameraFrameSource());
+    } else if(type == "video" && path != "") {
+        source = std::shared_ptr<FrameSource>(new VideoFrameSource(path));
+    } else if(type == "images" && path != "") {
+        source = std::shared_ptr<FrameSource>(new ImageFrameSource(path, false));
+    } else if(type == "raw" && path != "") {
+        source = std::shared_ptr<FrameSource>(new RecordingFrameSource(path));
+    } else {
+        return nullptr;
+    }
+
+    return std::shared_ptr<FrameSource>(new PreloadingFrameSource(source, DEFAULT_PRELOAD_DEPTH));
+}
@@ -0,0 +1,69 @@
+#include "Runner.h"
+
+/**
+ * Source file for the ImageFrameSource class.
+ * Written By: Brach Knutson
+ */
+
+using namespace cv;
+using namespace KiwiLight;
+
+/**
+ * Creates a new ImageFrameSource.
+ * @param path A directory of images, or a single image file.
+ * @param loop True to start over after the last image, false to finish.
+ */
+ImageFrameSource::ImageFrameSource(std::string path, bool loop) {
+    this->path = path;
+    this->loop = loop;
+    this->nextFile = 0;
+
+    DIR *directory = opendir(path.c_str());
+    if(directory != NULL) {
+        struct dirent *entry;
+        while((entry = readdir(directory)) != NULL) {
+            std::string name = std::string(entry->d_name);
+            if(name != "." && name != "..") {
+                this->files.push_back(path + "/" + name);
+            }
+        }
+
+        closedir(directory);
+        std::sort(this->files.begin(), this->files.end());
+    } else {
+        this->files.push_back(path);
+    }
+
+    if(this->files.size() == 0) {
+        std::cout << "WARNING: No images were found in \"" << path << "\"!" << std::endl;
+    }
+}
+
+/**
+ * Decodes the next image. Files that are not images are skipped.
+ * @return The image, or an empty Mat after the last image if not looping.
+ */
+cv::Mat ImageFrameSource::ReadFrame() {
+    //a single image never changes, so there is no need to decode it again
+    if(this->files.size() == 1 && !this->lastImage.empty()) {
+        return (this->loop ? this->lastImage : cv::Mat());
+    }
+
+    for(int skipped=0; skipped<this->files.size(); skipped++) {
+        if(this->nextFile >= this->files.size()) {
+            if(!this->loop) {
+                break;
+            }
+
+            this->nextFile = 0;
+        }
+
+        this->lastImage = cv::imread(this->files[this->nextFile]);
+        this->nextFile++;
+        if(!this->lastImage.empty()) {
+            return this->lastImage;
+        }
+    }
+
+    return cv::Mat();
+}
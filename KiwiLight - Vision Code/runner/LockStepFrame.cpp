@@ -0,0 +1,61 @@
+#include "Runner.h"
+
+/**
+ * Source file for the LockStepFrame class.
+ * Written By: Brach Knutson
+ */
+
+using namespace cv;
+using namespace KiwiLight;
+
+/**
+ * Creates a new LockStepFrame with one consumer and no frame yet.
+ */
+LockStepFrame::LockStepFrame() {
+    this->consumers = 1;
+    this->taken = 0;
+    this->finished.store(false);
+}
+
+/**
+ * Returns the current frame if it is newer than "afterId". Otherwise, waits until every consumer has taken 
+ * the current frame, then reads the next one. This method may be called from multiple threads.
+ * @param afterId The id of the last frame the caller processed.
+ * @param read Reads the next frame into its argument, returning false once there are no more.
+ * @return The frame, which is invalid once every frame has been read.
+ */
+SharedFrame LockStepFrame::Next(long afterId, std::function<bool(SharedFrame&)> read) {
+    std::unique_lock<std::mutex> lock(this->frameLock);
+    this->frameTaken.wait(lock, [&] {
+        return this->current.id > afterId || this->current.id < 0 || this->taken >= this->consumers || this->finished.load();
+    });
+
+    if(this->current.id <= afterId && !this->finished.load()) {
+        SharedFrame next;
+        if(read(next)) {
+            this->current = next;
+        } else {
+            this->finished.store(true);
+            this->current = SharedFrame();
+        }
+
+        this->taken = 0;
+    }
+
+    if(this->current.id > afterId) {
+        this->taken++;
+    }
+
+    this->frameTaken.notify_all();
+    return this->current;
+}
+
+/**
+ * Sets the number of consumers that must take each frame before the next one is read.
+ * Setting it back to 1 releases any consumer that is waiting for the others.
+ */
+void LockStepFrame::SetConsumers(int consumers) {
+    std::lock_guard<std::mutex> lock(this->frameLock);
+    this->consumers = std::max(consumers, 1);
+    this->frameTaken.notify_all();
+}
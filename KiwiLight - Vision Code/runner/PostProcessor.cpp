@@ -9,12 +9,18 @@ using namespace cv;
 using namespace KiwiLight;
 
 /**
- * Creates a new PostProcessor finding "targets."
- * DEPRECATED: PostProcessor is moving away from using multiple targets. this constructor is no longer needed.
+ * Creates a new PostProcessor finding all of "targets" in each image.
+ * The first target is the one that contour and runner properties are read from and written to.
  */
 PostProcessor::PostProcessor(std::vector<ExampleTarget> targets, bool debugging) {
     this->debugging = debugging;
+    if(targets.size() == 0) {
+        std::cout << "WARNING: PostProcessor created with no targets!" << std::endl;
+        return;
+    }
+
     this->target = targets[0];
+    this->others = std::vector<ExampleTarget>(targets.begin() + 1, targets.end());
 }
 
 /**
@@ -26,33 +32,43 @@ PostProcessor::PostProcessor(ExampleTarget target, bool debugging) {
 }
 
 /**
- * Sets the ExampleTarget that this PostProcessor is tasked with finding.
- * DEPRECATED: PostProcessor is moving away from using multiple targets. Use SetTarget(ExampleTarget) instead.
+ * Replaces the ExampleTarget with the given id, or adds "target" if there is none.
  */
 void PostProcessor::SetTarget(int id, ExampleTarget target) {
-    this->target = target;
-}
+    if(this->target.ID() == id) {
+        this->target = target;
+        return;
+    }
 
+    for(int i=0; i<this->others.size(); i++) {
+        if(this->others[i].ID() == id) {
+            this->others[i] = target;
+            return;
+        }
+    }
+
+    this->others.push_back(target);
+}
 
+/**
+ * Replaces the first ExampleTarget that this PostProcessor is tasked with finding.
+ */
 void PostProcessor::SetTarget(ExampleTarget target) {
     this->target = target;
 }
 
 /**
  * Returns the number of ExampleTargets that this PostProcessor is tasked with finding.
- * DEPRECATED: PostProcessor is moving away from using multiple targets. this method is no longer needed.
- * This method will now always return 1.
  */
 int PostProcessor::NumberOfTargets() {
-    return 1;
+    return 1 + this->others.size();
 }
 
 /**
- * Returns the number of contours of this PostProcessor's target.
- * DEPRECATED: PostProcessor is moving away from using multiple targets. Use NumberOfContours() instead.
+ * Returns the number of contours of the ExampleTarget with the given id.
  */
 int PostProcessor::NumberOfContours(int target) {
-    return NumberOfContours();
+    return GetExampleTargetByID(target).Contours().size();
 }
 
 /**
@@ -67,29 +83,75 @@ int PostProcessor::NumberOfContours() {
  * targets it finds.
  */
 std::vector<Target> PostProcessor::ProcessImage(cv::Mat img) {
+    return this->ProcessImage(img, cv::Point(0, 0));
+}
+
+/**
+ * Processes the given image (from the preprocessor) and returns a vector containing any 
+ * targets it finds.
+ * @param img The preprocessed image.
+ * @param offset Where the top-left corner of "img" is in the full frame. Contours and targets are moved by this much.
+ */
+std::vector<Target> PostProcessor::ProcessImage(cv::Mat img, cv::Point offset) {
     std::vector<Target> foundTargets = std::vector<Target>();
+    FrameArena arena;
+    this->ProcessImage(img, offset, foundTargets, arena);
+    return foundTargets;
+}
 
-    //find contours with input image
-    std::vector< std::vector< Point > > contours;
-    cv::findContours(img, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+/**
+ * Processes the given image (from the preprocessor) and stores the targets it finds in "targets".
+ * Only blobs that pass the cheap area and aspect ratio tests become Contours, so GetContoursFromLastFrame() 
+ * does not include specks that could never be part of the target.
+ * Buffers are kept between calls, and "targets" is reused, so this stops allocating once the 
+ * number of contours and targets settles.
+ * @param img The preprocessed image.
+ * @param offset Where the top-left corner of "img" is in the full frame. Contours and targets are moved by this much.
+ * @param targets Where to store the targets.
+ * @param arena Scratch memory for the target search.
+ */
+void PostProcessor::ProcessImage(cv::Mat img, cv::Point offset, std::vector<Target> &targets, FrameArena &arena) {
+    //label every blob and get its bounding box in one pass over the image
+    int numberOfLabels = cv::connectedComponentsWithStats(img, this->labels, this->stats, this->centroids, 8, CV_32S);
 
-    //create contour wrappers and prepare to compare with targets
-    std::vector<Contour> objects = std::vector<Contour>();
-    for(int i=0; i<contours.size(); i++) {
-        Contour newContour = Contour(contours[i]);
-        objects.push_back(newContour);
+    //only blobs with a bounding box that could pass the target's tests get a contour, which is where 
+    //the angle and solidity come from. On noisy images most blobs are thrown out here.
+    this->contoursFromLastFrame.Clear();
+    this->keepLabel.assign(numberOfLabels, 0);
+    this->backgroundLabeled = false;
+    bool anyKept = false;
+    for(int i=1; i<numberOfLabels; i++) { //label 0 is the background
+        cv::Rect bounds = this->LabelBounds(i);
+        if(this->MightHaveContour(bounds.width, bounds.height) && !this->InsideHole(img, i, bounds, numberOfLabels)) {
+            this->keepLabel[i] = 255;
+            anyKept = true;
+        }
     }
-    
-    this->contoursFromLastFrame = objects;
 
-    std::vector<Target> targs = this->target.GetTargets(objects);
+    if(anyKept) {
+        //mask the kept blobs in one pass and trace them all at once, so each pixel is only looked at once. 
+        //Kept blobs are never in each other's holes, so these are the contours that findContours() 
+        //finds on the whole image, minus the ones that failed the cheap tests.
+        this->blobMask.create(this->labels.size(), CV_8U);
+        for(int r=0; r<this->labels.rows; r++) {
+            const int *labelRow = this->labels.ptr<int>(r);
+            uchar *maskRow = this->blobMask.ptr<uchar>(r);
+            for(int c=0; c<this->labels.cols; c++) {
+                maskRow[c] = this->keepLabel[labelRow[c]];
+            }
+        }
 
-    // add results to our found targets 
-    for(int a=0; a<targs.size(); a++) {
-        foundTargets.push_back(targs[a]);
+        cv::findContours(this->blobMask, this->contourPoints, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE, offset);
+        for(int i=0; i<this->contourPoints.size(); i++) {
+            this->contoursFromLastFrame.Add(Contour(this->contourPoints[i]));
+        }
     }
 
-    return foundTargets;
+    if(this->others.size() == 0) {
+        this->target.GetTargets(this->contoursFromLastFrame, targets, arena);
+    } else {
+        this->FindAllTargets(targets, arena);
+    }
 }
 
 /**
@@ -99,6 +161,13 @@ std::vector<Contour> PostProcessor::GetValidContoursForTarget(std::vector<Contou
     return this->target.GetValidContours(contours);
 }
 
+/**
+ * Returns a vector containing only contours in the table that have a possiblity of being in the target.
+ */
+std::vector<Contour> PostProcessor::GetValidContoursForTarget(ContourTable &contours) {
+    return this->target.GetValidContours(contours);
+}
+
 /**
  * Sets a property of the one of the target's contours.
  * @param contour The ID of the contour to set the property of.
@@ -138,14 +207,145 @@ double PostProcessor::GetRunnerProperty(RunnerProperty prop) {
 }
 
 /**
- * Returns the ExampleTarget at id.
- * DEPRECATED: PostProcessor is moving away from using multiple targets. use GetTarget() instead.
+ * Returns the ExampleTarget with the given id, or the first target if there is none.
  */
 ExampleTarget PostProcessor::GetExampleTargetByID(int id) {
+    for(int i=0; i<this->others.size(); i++) {
+        if(this->others[i].ID() == id) {
+            return this->others[i];
+        }
+    }
+
     return GetTarget();
 }
 
-
+/**
+ * Returns the first ExampleTarget that this PostProcessor is tasked with finding.
+ */
 ExampleTarget PostProcessor::GetTarget() {
     return target;
+}
+
+/**
+ * Returns every ExampleTarget that this PostProcessor is tasked with finding, first target first.
+ */
+std::vector<ExampleTarget> PostProcessor::GetTargets() {
+    std::vector<ExampleTarget> targets = std::vector<ExampleTarget>();
+    targets.push_back(this->target);
+    targets.insert(targets.end(), this->others.begin(), this->others.end());
+    return targets;
+}
+
+/**
+ * Returns the bounding box of the blob with the given label from the last ProcessImage() call.
+ */
+cv::Rect PostProcessor::LabelBounds(int label) {
+    return cv::Rect(
+        this->stats.at<int>(label, cv::CC_STAT_LEFT),
+        this->stats.at<int>(label, cv::CC_STAT_TOP),
+        this->stats.at<int>(label, cv::CC_STAT_WIDTH),
+        this->stats.at<int>(label, cv::CC_STAT_HEIGHT)
+    );
+}
+
+/**
+ * Returns true if the blob with the given label sits in a hole of another blob. 
+ * findContours(RETR_EXTERNAL) never returns those, so neither does ProcessImage().
+ * @param img The preprocessed image that was labeled.
+ * @param label The label of the blob.
+ * @param bounds The bounding box of the blob.
+ * @param numberOfLabels The number of labels in the image, including the background.
+ */
+bool PostProcessor::InsideHole(cv::Mat img, int label, cv::Rect bounds, int numberOfLabels) {
+    //a blob can only be in a hole of a blob whose bounding box surrounds its own, which is rare
+    bool surrounded = false;
+    for(int i=1; i<numberOfLabels && !surrounded; i++) {
+        cv::Rect other = this->LabelBounds(i);
+        surrounded = i != label &&
+                     other.x < bounds.x && other.y < bounds.y &&
+                     other.br().x > bounds.br().x && other.br().y > bounds.br().y;
+    }
+
+    if(!surrounded || bounds.y == 0) {
+        return false;
+    }
+
+    //label the background once per frame, and mark the parts that reach the edge of the image. 
+    //Background is 4-connected when blobs are 8-connected, so every other part is a hole.
+    if(!this->backgroundLabeled) {
+        cv::compare(img, 0, this->backgroundMask, cv::CMP_EQ);
+        int numberOfBackgrounds = cv::connectedComponents(this->backgroundMask, this->backgroundLabels, 4, CV_32S);
+        this->outsideBackground.assign(numberOfBackgrounds, false);
+        for(int c=0; c<this->backgroundLabels.cols; c++) {
+            this->outsideBackground[this->backgroundLabels.at<int>(0, c)] = true;
+            this->outsideBackground[this->backgroundLabels.at<int>(this->backgroundLabels.rows - 1, c)] = true;
+        }
+        for(int r=0; r<this->backgroundLabels.rows; r++) {
+            this->outsideBackground[this->backgroundLabels.at<int>(r, 0)] = true;
+            this->outsideBackground[this->backgroundLabels.at<int>(r, this->backgroundLabels.cols - 1)] = true;
+        }
+
+        this->outsideBackground[0] = false; //label 0 is the blobs
+        this->backgroundLabeled = true;
+    }
+
+    //the pixel above the first pixel of the blob's top row is background just outside the blob
+    int x = bounds.x;
+    while(this->labels.at<int>(bounds.y, x) != label) {
+        x++;
+    }
+
+    return !this->outsideBackground[this->backgroundLabels.at<int>(bounds.y - 1, x)];
+}
+
+/**
+ * Returns true if a blob with the given bounding box could be part of any of the targets.
+ */
+bool PostProcessor::MightHaveContour(int width, int height) {
+    if(this->target.MightHaveContour(width, height)) {
+        return true;
+    }
+
+    for(int i=0; i<this->others.size(); i++) {
+        if(this->others[i].MightHaveContour(width, height)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Searches the contours from the last frame for every target at once. The targets after the first are handed to 
+ * the worker threads, each with its own arena and results, while this thread searches for the first target. 
+ * All targets share the same ContourTable, which is only read from during the search.
+ * Targets of the first ExampleTarget come first in "targets", and every Target's ID() tells which ExampleTarget it is.
+ * @param targets Where to store the targets.
+ * @param arena Scratch memory for the first target's search.
+ */
+void PostProcessor::FindAllTargets(std::vector<Target> &targets, FrameArena &arena) {
+    int numberOfOthers = this->others.size();
+    if(!this->workers.pool) {
+        int threads = std::min(numberOfOthers, (int) std::max(1u, std::thread::hardware_concurrency()));
+        this->workers.pool = std::unique_ptr<ThreadPool>(new ThreadPool(threads));
+    }
+
+    if(this->workers.results.size() != numberOfOthers) {
+        this->workers.results.resize(numberOfOthers);
+        this->workers.arenas.resize(numberOfOthers);
+    }
+
+    for(int i=0; i<numberOfOthers; i++) {
+        this->workers.pool->Submit([this, i] () {
+            this->workers.arenas[i].Reset();
+            this->others[i].GetTargets(this->contoursFromLastFrame, this->workers.results[i], this->workers.arenas[i]);
+        });
+    }
+
+    this->target.GetTargets(this->contoursFromLastFrame, targets, arena);
+    this->workers.pool->Wait();
+
+    for(int i=0; i<numberOfOthers; i++) {
+        targets.insert(targets.end(), this->workers.results[i].begin(), this->workers.results[i].end());
+    }
 }
\ No newline at end of file
@@ -26,6 +26,8 @@ PreProcessor::PreProcessor(bool fullPreprocessor, Color targetColor, int thresho
     this->threshtype = 0;
     this->erode = erosion;
     this->dilate = dilation;
+    this->maskMorphology = false;
+    this->Compile();
 }
 
 /**
@@ -33,24 +35,48 @@ PreProcessor::PreProcessor(bool fullPreprocessor, Color targetColor, int thresho
  */
 cv::Mat PreProcessor::ProcessImage(cv::Mat img) {
     cv::Mat out;
+    this->ProcessImage(img, out);
+    return out;
+}
 
-    if(this->isFullPreprocessor) {
-        cv::threshold(img, img, this->threshold, this->threshValue, this->threshtype);
-        cv::Mat dilateKernel = cv::getStructuringElement(cv::MORPH_RECT, 
-                                                cv::Size(this->dilate, this->dilate));
-                                                
-        cv::Mat erodeKernel = cv::getStructuringElement(cv::MORPH_RECT,
-                                                        cv::Size(this->erode, this->erode));
-        
-        cv::erode(img, img, erodeKernel);
-        cv::dilate(img, img, dilateKernel);
-        cv::cvtColor(img, img, cv::COLOR_BGR2HSV);
-        cv::inRange(img, this->targetColor.GetLowerBound(), this->targetColor.GetUpperBound(), out);
+/**
+ * Takes the given generic image and writes a version usable by the PostProcessor to "out".
+ * Once the image size settles, nothing is allocated here: the plan is only swapped when a setting changes,
+ * and "out" and the scratch buffers are reused.
+ * @param img The image to process. It is not modified.
+ * @param out Where to write the processed image. Must not be the same Mat as "img".
+ */
+void PreProcessor::ProcessImage(const cv::Mat &img, cv::Mat &out) {
+    std::shared_ptr<const PreProcessorPlan> plan = std::atomic_load(&this->plan);
+
+    if(plan && plan->isFullPreprocessor && plan->maskMorphology) {
+        //segment first, then clean up the single-channel mask with packed binary morphology.
+        plan->classifier.Classify(img, out);
+        this->scratch.morphology.Apply(out, out, plan->erode, plan->dilate);
+    } else if(plan && plan->isFullPreprocessor) {
+        //thresholding is done by the classifier. Erosion and dilation give the same result before or after it.
+        cv::erode(img, this->scratch.filtered, plan->erodeKernel);
+        cv::dilate(this->scratch.filtered, this->scratch.filtered, plan->dilateKernel);
+        plan->classifier.Classify(this->scratch.filtered, out);
     } else {
         cv::cvtColor(img, out, cv::COLOR_BGR2GRAY);
     }
+}
 
-    return out;
+/**
+ * Finds the pixels of the target color in "img" without eroding or dilating, so that small objects survive
+ * on downscaled images. Partial preprocessors just make the image gray.
+ * @param img The image to segment. It is not modified.
+ * @param out Where to write the mask. Must not be the same Mat as "img".
+ */
+void PreProcessor::Segment(const cv::Mat &img, cv::Mat &out) {
+    std::shared_ptr<const PreProcessorPlan> plan = std::atomic_load(&this->plan);
+
+    if(plan && plan->isFullPreprocessor) {
+        plan->classifier.Classify(img, out);
+    } else {
+        cv::cvtColor(img, out, cv::COLOR_BGR2GRAY);
+    }
 }
 
 /**
@@ -59,6 +85,8 @@ cv::Mat PreProcessor::ProcessImage(cv::Mat img) {
  * @param value The value to set the property to.
  */
 void PreProcessor::SetProperty(PreProcessorProperty prop, double value) {
+    double previousValue = this->GetProperty(prop);
+
     switch(prop) {
         case PreProcessorProperty::IS_FULL:
             this->isFullPreprocessor = (value == 1 ? true : false);
@@ -72,6 +100,9 @@ void PreProcessor::SetProperty(PreProcessorProperty prop, double value) {
         case PreProcessorProperty::DILATION:
             this->dilate = value;
             break;
+        case PreProcessorProperty::MASK_MORPHOLOGY:
+            this->maskMorphology = (value == 1 ? true : false);
+            break;
         case PreProcessorProperty::COLOR_HUE:
             {
             Color newColor = Color((int) value, this->targetColor.GetS(), this->targetColor.GetV(), this->targetColor.GetHError(), this->targetColor.GetSError(), this->targetColor.GetVError());
@@ -98,6 +129,11 @@ void PreProcessor::SetProperty(PreProcessorProperty prop, double value) {
             break;
             }
     }
+
+    //the UI sets every property each frame, so only build a new plan when something really changed
+    if(this->GetProperty(prop) != previousValue) {
+        this->Compile();
+    }
 }
 
 /**
@@ -121,6 +157,9 @@ double PreProcessor::GetProperty(PreProcessorProperty prop) {
         case PreProcessorProperty::DILATION:
             finalValue = this->dilate;
             break;
+        case PreProcessorProperty::MASK_MORPHOLOGY:
+            finalValue = (this->maskMorphology ? 1 : 0);
+            break;
         case PreProcessorProperty::COLOR_HUE:
             finalValue = this->targetColor.GetH();
             break;
@@ -141,6 +180,18 @@ double PreProcessor::GetProperty(PreProcessorProperty prop) {
     return finalValue;
 }
 
+/**
+ * Builds a plan from the current settings and swaps it in. A frame that is being processed
+ * keeps using the plan it started with.
+ */
+void PreProcessor::Compile() {
+    std::shared_ptr<const PreProcessorPlan> newPlan = std::shared_ptr<const PreProcessorPlan>(
+        new PreProcessorPlan(this->isFullPreprocessor, this->maskMorphology, this->targetColor, this->threshold, this->erode, this->dilate)
+    );
+
+    std::atomic_store(&this->plan, newPlan);
+}
+
 /**
  * Returns a string summary of this PreProcessor.
  */
@@ -153,6 +204,7 @@ std::string PreProcessor::toString() {
                       std::string("Type: FULL\n") +
                       std::string("Threshold Value: ") + std::to_string(this->threshold) + endline +
                       std::string("Dilation: ") + std::to_string(this->dilate) + endline + 
+                      std::string("Morphology: ") + std::string((this->maskMorphology ? "MASK" : "COLOR")) + endline + 
                       std::string("Color H: ") + std::to_string(this->targetColor.GetH()) + endline + 
                       std::string("Color S: ") + std::to_string(this->targetColor.GetS()) + endline + 
                       std::string("Color V: ") + std::to_string(this->targetColor.GetV()) + endline +
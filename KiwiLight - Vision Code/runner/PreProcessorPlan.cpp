@@ -0,0 +1,28 @@
+#include "Runner.h"
+
+/**
+ * Source file for the PreProcessorPlan struct.
+ * Written By: Brach Knutson
+ */
+
+using namespace cv;
+using namespace KiwiLight;
+
+/**
+ * Builds the kernels and color lookup tables for a set of PreProcessor settings.
+ * @param fullPreprocessor True if raw images should be fully preprocessed, false if they only need to be made gray.
+ * @param maskMorphology True to erode and dilate the mask after classifying, false to erode and dilate the image before.
+ * @param targetColor The color of the objects.
+ * @param threshold The amount of light required to highlight objects.
+ * @param erosion The size of the erosion kernel.
+ * @param dilation The size of the dilation kernel.
+ */
+PreProcessorPlan::PreProcessorPlan(bool fullPreprocessor, bool maskMorphology, Color targetColor, double threshold, int erosion, int dilation) {
+    this->isFullPreprocessor = fullPreprocessor;
+    this->maskMorphology = maskMorphology;
+    this->erode = erosion;
+    this->dilate = dilation;
+    this->erodeKernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(erosion, erosion));
+    this->dilateKernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(dilation, dilation));
+    this->classifier = ColorClassifier(targetColor, threshold);
+}
@@ -0,0 +1,68 @@
+#include "Runner.h"
+
+/**
+ * Source file for the PreloadingFrameSource class.
+ * Written By: Brach Knutson
+ */
+
+using namespace cv;
+using namespace KiwiLight;
+
+/**
+ * Creates a new PreloadingFrameSource and starts reading from "source".
+ * @param source The source to read ahead from. It should not be used by anything else.
+ * @param depth The number of frames to read ahead.
+ */
+PreloadingFrameSource::PreloadingFrameSource(std::shared_ptr<FrameSource> source, int depth)
+ : preloaded(depth) {
+    this->source = source;
+    this->running.store(true);
+    this->preloadThread = std::thread(&PreloadingFrameSource::PreloadLoop, this);
+}
+
+/**
+ * Stops the preloading thread.
+ */
+PreloadingFrameSource::~PreloadingFrameSource() {
+    this->running.store(false);
+    this->preloaded.Close();
+    if(this->preloadThread.joinable()) {
+        this->preloadThread.join();
+    }
+}
+
+/**
+ * Returns the current frame if it is newer than "afterId", otherwise the next preloaded one once every 
+ * consumer has taken the current one, waiting for it if needed. This method may be called from multiple threads.
+ * @param afterId The id of the last frame the caller processed.
+ * @return The frame, which is invalid once the source has run out.
+ */
+SharedFrame PreloadingFrameSource::Next(long afterId) {
+    return this->frame.Next(afterId, [this](SharedFrame &next) {
+        return this->preloaded.Pop(next);
+    });
+}
+
+/**
+ * Reads frames from the source until it runs out or this source is destroyed.
+ */
+void PreloadingFrameSource::PreloadLoop() {
+    long lastFrameId = -1;
+    while(this->running.load()) {
+        SharedFrame frame = this->source->Next(lastFrameId);
+        if(!frame.Valid()) {
+            if(this->source->Finished()) {
+                break;
+            }
+
+            continue;
+        }
+
+        lastFrameId = frame.id;
+        if(!this->preloaded.Push(frame)) {
+            break;
+        }
+    }
+
+    this->preloaded.Close();
+}
@@ -0,0 +1,36 @@
+#include "Runner.h"
+
+/**
+ * Source file for the RecordingFrameSource class.
+ * Written By: Brach Knutson
+ */
+
+using namespace cv;
+using namespace KiwiLight;
+
+/**
+ * Creates a new RecordingFrameSource.
+ * @param fileName The path to a recording made by a FrameRecorder.
+ */
+RecordingFrameSource::RecordingFrameSource(std::string fileName)
+ : recording(fileName) {
+    this->fileName = fileName;
+    this->nextFrame = 0;
+    this->lastTimestamp = 0;
+}
+
+/**
+ * Reads the next frame of the recording.
+ * @return The frame, or an empty Mat at the end of the recording.
+ */
+cv::Mat RecordingFrameSource::ReadFrame() {
+    //every frame gets its own buffer because the frames handed out before it may still be in use
+    cv::Mat image;
+    if(!this->recording.Read(this->nextFrame, image)) {
+        return cv::Mat();
+    }
+
+    this->lastTimestamp = this->recording.Timestamp(this->nextFrame);
+    this->nextFrame++;
+    return image;
+}
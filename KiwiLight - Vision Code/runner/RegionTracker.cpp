@@ -0,0 +1,123 @@
+#include "Runner.h"
+
+/**
+ * Source file for the RegionTracker class.
+ * Written By: Brach Knutson
+ */
+
+using namespace cv;
+using namespace KiwiLight;
+
+const int RegionTracker::DEFAULT_PADDING = 50;
+const int RegionTracker::DEFAULT_REFRESH_FRAMES = 30;
+
+/**
+ * Creates a new RegionTracker that always searches the whole frame.
+ */
+RegionTracker::RegionTracker() 
+ : RegionTracker(false, DEFAULT_PADDING, DEFAULT_REFRESH_FRAMES) {
+}
+
+/**
+ * Creates a new RegionTracker.
+ * @param enabled True if searches should be narrowed to a window around the last target, false to always search the whole frame.
+ * @param padding How far the window reaches past the last target on each side, as a percentage of the target's size.
+ * @param refreshFrames The number of window searches allowed in a row before the whole frame is searched again.
+ */
+RegionTracker::RegionTracker(bool enabled, int padding, int refreshFrames) {
+    this->enabled = enabled;
+    this->padding = std::max(padding, 0);
+    this->refreshFrames = std::max(refreshFrames, 1);
+    this->locked = false;
+    this->windowsInARow = 0;
+    this->fullSearches = 0;
+    this->windowSearches = 0;
+}
+
+/**
+ * Creates a copy of "other". The copy gets its own lock.
+ */
+RegionTracker::RegionTracker(const RegionTracker &other) {
+    *this = other;
+}
+
+/**
+ * Copies the settings and tracking state of "other" into this tracker.
+ */
+RegionTracker &RegionTracker::operator=(const RegionTracker &other) {
+    if(this == &other) {
+        return *this;
+    }
+
+    std::lock_guard<std::mutex> lock(other.trackerLock);
+    this->enabled = other.enabled;
+    this->padding = other.padding;
+    this->refreshFrames = other.refreshFrames;
+    this->locked = other.locked;
+    this->lastBounds = other.lastBounds;
+    this->windowsInARow = other.windowsInARow;
+    this->fullSearches = other.fullSearches;
+    this->windowSearches = other.windowSearches;
+    return *this;
+}
+
+/**
+ * Returns the part of a frame of "frameSize" that should be searched next. This is the whole frame unless
+ * a target is locked, in which case it is a padded window around the target.
+ */
+cv::Rect RegionTracker::NextRegion(cv::Size frameSize) {
+    std::lock_guard<std::mutex> lock(this->trackerLock);
+    cv::Rect fullFrame = cv::Rect(0, 0, frameSize.width, frameSize.height);
+
+    if(!this->enabled || !this->locked || this->windowsInARow >= this->refreshFrames) {
+        this->windowsInARow = 0;
+        this->fullSearches++;
+        return fullFrame;
+    }
+
+    int padX = this->lastBounds.width * this->padding / 100;
+    int padY = this->lastBounds.height * this->padding / 100;
+    cv::Rect window = cv::Rect(
+        this->lastBounds.x - padX, 
+        this->lastBounds.y - padY, 
+        this->lastBounds.width + (2 * padX), 
+        this->lastBounds.height + (2 * padY)
+    ) & fullFrame;
+
+    if(window.area() == 0) {
+        this->locked = false;
+        this->windowsInARow = 0;
+        this->fullSearches++;
+        return fullFrame;
+    }
+
+    this->windowsInARow++;
+    this->windowSearches++;
+    return window;
+}
+
+/**
+ * Tells the tracker how the search of a frame went. Locks onto "targetBounds" after a detection, 
+ * and goes back to searching whole frames after a miss.
+ * @param found True if a target was found in the frame.
+ * @param targetBounds The bounds of the found target in full-frame coordinates.
+ */
+void RegionTracker::Update(bool found, cv::Rect targetBounds) {
+    std::lock_guard<std::mutex> lock(this->trackerLock);
+    this->locked = this->enabled && found && targetBounds.area() > 0;
+    if(this->locked) {
+        this->lastBounds = targetBounds;
+    } else {
+        this->windowsInARow = 0;
+    }
+}
+
+/**
+ * Returns a human readable summary of how many searches were narrowed to a window.
+ */
+std::string RegionTracker::Summary() {
+    std::lock_guard<std::mutex> lock(this->trackerLock);
+    long total = this->fullSearches + this->windowSearches;
+    double windowPercent = (total > 0 ? this->windowSearches * 100.0 / total : 0);
+    return std::to_string(this->windowSearches) + " window searches, " + std::to_string(this->fullSearches) + " full searches (" + std::to_string(windowPercent) + "% windowed)";
+}
@@ -9,6 +9,10 @@ using namespace cv;
 using namespace KiwiLight;
 
 const std::string Runner::NULL_MESSAGE = ":-1,-1,-1,-1,-1,180,180;";
+const int Runner::MAX_PYRAMID_CANDIDATES = 32;
+
+std::shared_ptr<FrameSource> Runner::frameSource;
+std::mutex                   Runner::frameSourceLock;
 
 /**
  * Creates a new runner which runs the configuration described by the given file
@@ -20,6 +24,14 @@ Runner::Runner(std::string fileName, bool debugging, bool applyCameraSettings) {
     this->src = fileName;
     this->debug = debugging;
     this->lastIterationSuccessful = false;
+    this->lastFrameId = -1;
+    this->lastFrameTimestamp = 0;
+    this->lastFrameLatency = 0;
+    this->sendAge = false;
+    this->sendBinary = false;
+    this->lastFrameCaptured = false;
+    this->lastFrameFoundTarget = false;
+    this->packetSequence = 0;
     XMLDocument file = XMLDocument(fileName);
     if(file.HasContents()) {
         this->parseDocument(file);
@@ -38,129 +50,252 @@ void Runner::SetImageResize(Size sz) {
 }
 
 /**
- * Performs one iteration of the main loop, but does not send any file UDP messages.
- * @return The message that should be sent to the RIO.
+ * Takes the frame that Runners should process next from the current FrameSource. Every caller asking 
+ * for a frame after the same id gets the same image, so several Runners can work on one grab.
+ * @param afterId The id of the last frame the caller processed.
+ * @return A frame newer than "afterId" if one arrives in time, otherwise the newest frame.
  */
-std::string Runner::Iterate() {
-    cv::Mat img;
-    cv::Mat out; //output image we draw on for debugging
-    if(RunnerSettings::USE_CAMERA) {
-        img = KiwiLightApp::TakeImage();
+SharedFrame Runner::TakeFrame(long afterId) {
+    return GetFrameSource()->Next(afterId);
+}
 
-        if(img.empty()) {
-            //oops we shall exit now because there be nothing in image
-            return NULL_MESSAGE;
+/**
+ * Returns the FrameSource that all Runners take their frames from. Unless another source was set, 
+ * this is the camera, or RunnerSettings::IMAGE_TO_USE if RunnerSettings::USE_CAMERA is false.
+ */
+std::shared_ptr<FrameSource> Runner::GetFrameSource() {
+    std::lock_guard<std::mutex> lock(Runner::frameSourceLock);
+    if(!Runner::frameSource) {
+        if(RunnerSettings::USE_CAMERA) {
+            Runner::frameSource = std::shared_ptr<FrameSource>(new CameraFrameSource());
+        } else {
+            Runner::frameSource = std::shared_ptr<FrameSource>(new ImageFrameSource(RunnerSettings::IMAGE_TO_USE, true));
         }
+    }
+
+    return Runner::frameSource;
+}
+
+/**
+ * Makes all Runners take their frames from "source".
+ */
+void Runner::SetFrameSource(std::shared_ptr<FrameSource> source) {
+    std::lock_guard<std::mutex> lock(Runner::frameSourceLock);
+    Runner::frameSource = source;
+}
+
+/**
+ * Performs one iteration of the main loop, but does not send any file UDP messages.
+ * @return The message that should be sent to the RIO. It is only valid until the next iteration.
+ */
+const std::string &Runner::Iterate() {
+    return this->Iterate(TakeFrame(this->lastFrameId));
+}
+
+/**
+ * Performs one iteration of the main loop on "source", but does not send any file UDP messages.
+ * @param source The frame to process. It is only read from, so it may be shared with other Runners.
+ * @return The message that should be sent to the RIO. It is only valid until the next iteration.
+ */
+const std::string &Runner::Iterate(SharedFrame source) {
+    //the frame's buffers are reused, so nothing is allocated once their sizes settle
+    RunnerFrame &frame = this->workspace.frame;
+    long long allocationsBefore = AllocationCounter::Count();
+
+    if(this->CaptureFrame(frame, source)) {
+        this->PreProcessFrame(frame);
+        this->PostProcessFrame(frame);
+    }
+
+    //FinishFrame() hands back NULL_MESSAGE if there was nothing in the image
+    const std::string &message = this->FinishFrame(frame);
+    this->lastFrameAllocations = AllocationCounter::Count() - allocationsBefore;
+    return message;
+}
+
+/**
+ * First stage of an iteration. Resizes the image of "source" into frame.original.
+ * @param frame The frame to fill.
+ * @param source The frame to take the image from. Its image is never written to.
+ * @return True if there was an image, false otherwise.
+ */
+bool Runner::CaptureFrame(RunnerFrame &frame, SharedFrame source) {
+    frame.frameId = source.id;
+    frame.timestamp = source.timestamp;
+    frame.captured = source.Valid();
+    this->lastIterationSuccessful = frame.captured;
+    if(!frame.captured) {
+        return false;
+    }
+
+    //frame.original never shares a buffer with the source, so the shared image stays untouched
+    resize(*source.image, frame.original, this->constantResize);
+    frame.region = this->regionTracker.NextRegion(frame.original.size());
+    return true;
+}
+
+/**
+ * Second stage of an iteration. Runs the PreProcessor on frame.region of frame.original and stores the result in frame.processed.
+ * frame.original is left untouched.
+ */
+void Runner::PreProcessFrame(RunnerFrame &frame) {
+    if(this->pyramidScale > 1) {
+        this->PreProcessPyramid(frame);
     } else {
-        this->lastIterationSuccessful = true;
-        img = cv::imread(RunnerSettings::IMAGE_TO_USE);
+        this->preprocessor.ProcessImage(frame.original(frame.region), frame.processed);
     }
-    
-    resize(img, img, this->constantResize);
-    img.copyTo(this->originalImage);
-    img = this->preprocessor.ProcessImage(img);
-    img.copyTo(out);
-    std::vector<Target> targets = this->postprocessor.ProcessImage(img);
-    //find the percieved robot center using this->centerOffset
-    int trueCenterX = (this->constantResize.width / 2);
-    int robotCenterX = trueCenterX;
+}
 
-    int trueCenterY = (this->constantResize.height / 2);
-    int robotCenterY = trueCenterY;
+/**
+ * Third stage of an iteration. Finds the contours and targets in frame.processed, in full-frame coordinates.
+ */
+void Runner::PostProcessFrame(RunnerFrame &frame) {
+    this->workspace.arena.Reset();
+    this->postprocessor.ProcessImage(frame.processed, frame.region.tl(), frame.targets, this->workspace.arena);
+    frame.contours = this->postprocessor.GetContoursFromLastFrame();
+}
+
+/**
+ * Last stage of an iteration. Picks the target closest to the robot center, updates the Runner's 
+ * last-frame information, and marks up the output image when debugging.
+ * @return The message that should be sent to the RIO. It is only valid until the next call.
+ */
+const std::string &Runner::FinishFrame(RunnerFrame &frame) {
+    this->lastFrameId = frame.frameId;
+    this->lastFrameCaptured = frame.captured;
+    this->lastFrameFoundTarget = false;
+    if(!frame.captured) {
+        //binary receivers count packets by their sequence numbers, so a frame without an image still gets one
+        if(this->sendBinary) {
+            this->BuildEmptyPacket();
+        }
+
+        return NULL_MESSAGE;
+    }
+
+    this->originalImage = frame.original;
+    this->lastFrameTimestamp = frame.timestamp;
+    std::vector<Target> &targets = frame.targets;
+
+    //the message is sent as soon as it is built, so this is when the prediction and age are for
+    long long sendTime = Clock::GetMonotonicTime();
 
     //find the target that is closest to the robot center
-    Target bestTarget;
+    int bestTargetIndex = -1;
     int closestDist = 5000; // closest horizontal distance to the center
     for(int i=0; i<targets.size(); i++) {
-        Target targ = targets[i];
-
-        //find the offset center of the camera based on the target's distance
-        double inchesPerPixel = targ.KnownWidth() / targ.Bounds().width;
-        double centerInchesX = trueCenterX * inchesPerPixel;
-        double centerInchesY = trueCenterY * inchesPerPixel;
-
-        double offsetInchesX = centerInchesX - this->centerOffsetX;
-        double offestInchesY = centerInchesY - this->centerOffsetY;
-    
-        //convert back to pixels
-        double offsetPixelsX = offsetInchesX / inchesPerPixel;
-        double offsetPixelsY = offestInchesY / inchesPerPixel;
+        Target &targ = targets[i];
 
         //calculate the distance from the offset center
-        double distFromCenterX = offsetPixelsX - targ.Center().x;
-        double distFromCenterY = offsetPixelsY - targ.Center().y;
+        cv::Point robotCenter = this->RobotCenterFor(targ);
+        double distFromCenterX = robotCenter.x - targ.Center().x;
+        double distFromCenterY = robotCenter.y - targ.Center().y;
         double trueDistance = sqrt(pow(distFromCenterX, 2) + pow(distFromCenterY, 2));
 
         if(trueDistance < closestDist) {
             closestDist = trueDistance;
-            bestTarget = targ;
-            robotCenterX = (int) offsetPixelsX;
-            robotCenterY = (int) offsetPixelsY;
+            bestTargetIndex = i;
         }
     }
 
-    this->closestTarget = bestTarget;
-    this->lastFrameCenterPoint = Point(robotCenterX, robotCenterY);
+    //assigning into the kept Target reuses its memory
+    if(bestTargetIndex >= 0) {
+        this->closestTarget = targets[bestTargetIndex];
+    } else {
+        this->closestTarget = Target();
+    }
 
-    //figure out which target to send and then send the target
-    int coordX   = -1,
-        coordY   = -1,
-        width    = -1,
-        height   = -1,
-        distance = -1,
-        HAngle   = 180,
-        VAngle   = 180;
+    //with target tracking, the tracked target is sent instead. It is smoothed at the time the frame was 
+    //captured, and predicted again to now, which is when the message is sent
+    bool found = targets.size() > 0;
+    bool predicted = false;
+    if(this->targetTracker.Enabled()) {
+        this->targetTracker.Update(frame.timestamp, targets, bestTargetIndex);
+        found = this->targetTracker.Estimate(frame.timestamp, this->trackedTarget);
+        predicted = this->targetTracker.Estimate(sendTime, this->predictedTarget);
+    }
 
-    std::string rioMessage = "";
-    
-    if(targets.size() > 0) {
-        //use the best target to fill in the information to send to the rio
-        coordX = bestTarget.Center().x;
-        coordY = bestTarget.Center().y;
-        
-        width = bestTarget.Bounds().width;
-        height = bestTarget.Bounds().height;
+    this->lastFrameFoundTarget = found;
+    Target &bestTarget = (this->targetTracker.Enabled() ? this->trackedTarget : this->closestTarget);
+    cv::Point robotCenter = cv::Point(this->constantResize.width / 2, this->constantResize.height / 2);
+    if(found) {
+        robotCenter = this->RobotCenterFor(bestTarget);
+    }
 
-        distance = bestTarget.Distance();
+    this->lastFrameCenterPoint = robotCenter;
 
-        HAngle = bestTarget.HorizontalAngle(distance, robotCenterX);
-        VAngle = bestTarget.VerticalAngle(distance, robotCenterY);
+    //with more than one kind of target, the window has to cover all of them or the others would be cropped out
+    bool tracking = targets.size() > 0;
+    cv::Rect trackedBounds = this->closestTarget.Bounds();
+    if(this->targetTracker.Enabled()) {
+        //where the tracks should be next frame, which keeps the window on targets that were just missed
+        trackedBounds = this->targetTracker.NextBounds();
+        tracking = trackedBounds.area() > 0;
+    } else if(this->postprocessor.NumberOfTargets() > 1) {
+        for(int i=0; i<targets.size(); i++) {
+            trackedBounds |= targets[i].Bounds();
+        }
     }
 
+    this->regionTracker.Update(tracking, trackedBounds);
     this->lastFrameTargets = targets;
 
-    std::string x = std::to_string(coordX),
-                y = std::to_string(coordY),
-                w = std::to_string(width),
-                h = std::to_string(height),
-                d = std::to_string(distance),
-                ax = std::to_string(HAngle),
-                ay = std::to_string(VAngle);
+    //format the message on the stack, then copy it into the workspace string, whose memory is reused every frame
+    char messageBuffer[MAX_MESSAGE_SIZE];
+    MessageWriter messageWriter = MessageWriter(messageBuffer, MAX_MESSAGE_SIZE);
+    messageWriter.Append(':');
+    this->AppendTarget(messageWriter, bestTarget, found);
+    if(this->targetTracker.Enabled()) {
+        //the same fields again, for where the target should be by the time the message arrives
+        messageWriter.Append(',');
+        this->AppendTarget(messageWriter, this->predictedTarget, predicted);
+    }
+
+    //how long ago the frame was captured, so the robot can line the target up with where it was at the time
+    this->lastFrameLatency = std::max(sendTime - frame.timestamp, 0LL);
+    if(this->sendAge) {
+        messageWriter.Append(',');
+        messageWriter.Append(this->lastFrameLatency / 1000);
+    }
+
+    messageWriter.Append(';');
+    std::string &rioMessage = this->workspace.message;
+    rioMessage.assign(messageWriter.Data(), messageWriter.Size());
 
-    rioMessage = ":" + x + "," + y + "," + w + "," + h +"," + d + "," + ax + "," + ay + ";";
+    if(this->sendBinary) {
+        this->BuildPacket(frame, bestTarget, found, predicted, bestTargetIndex);
+    }
 
     //mark up the image with some stuff for the programmers to look at :)
     if(this->debug) {
-        cv::cvtColor(out, out, cv::COLOR_GRAY2BGR);
+        cv::Mat out; //output image we draw on for debugging
+        if(frame.region.size() == frame.original.size()) {
+            cv::cvtColor(frame.processed, out, cv::COLOR_GRAY2BGR);
+        } else {
+            //only the tracked window was processed, so show it in place on an otherwise empty frame
+            out = cv::Mat::zeros(frame.original.size(), CV_8UC3);
+            cv::Mat window = out(frame.region);
+            cv::cvtColor(frame.processed, window, cv::COLOR_GRAY2BGR);
+            cv::rectangle(out, frame.region, cv::Scalar(0, 255, 255), 1);
+        }
 
         //write the out string onto the image
         cv::putText(out, rioMessage, cv::Point(5, 15), cv::FONT_HERSHEY_PLAIN, 1.0, cv::Scalar(0,0,255), 2);
         
         //draw a line where the perceived horizontal robot center is
         int camHeight = this->constantResize.height;
-        cv::Point HlineTopPoint    = cv::Point(robotCenterX, 0);
-        cv::Point HlineBottomPoint = cv::Point(robotCenterX, camHeight);
+        cv::Point HlineTopPoint    = cv::Point(robotCenter.x, 0);
+        cv::Point HlineBottomPoint = cv::Point(robotCenter.x, camHeight);
         cv::line(out, HlineTopPoint, HlineBottomPoint, cv::Scalar(255,0,255));
 
         //draw another line where the vertical robot center is
         int camWidth = this->constantResize.width;
-        cv::Point VlineTopPoint    = cv::Point(0, robotCenterY);
-        cv::Point VlineBottomPoint = cv::Point(camWidth, robotCenterY);
+        cv::Point VlineTopPoint    = cv::Point(0, robotCenter.y);
+        cv::Point VlineBottomPoint = cv::Point(camWidth, robotCenter.y);
         cv::line(out, VlineTopPoint, VlineBottomPoint, cv::Scalar(255, 0, 255));
         
         //draw a dot in the center of each valid contour
-        std::vector<Contour> contoursFromFrame = this->postprocessor.GetContoursFromLastFrame();
-        std::vector<Contour> validContours = this->postprocessor.GetValidContoursForTarget(contoursFromFrame);
+        std::vector<Contour> validContours = this->postprocessor.GetValidContoursForTarget(frame.contours);
         
         Target targ = Target(0, validContours, 0, 0, 0, 0, DistanceCalcMode::BY_WIDTH);
         rectangle(out, targ.Bounds(), Scalar(0, 0, 255), 3);
@@ -184,7 +319,14 @@ std::string Runner::Iterate() {
         }
 
         //draw a special dot in the center of the target for which we send data
-        cv::circle(out, bestTarget.Center(), 2, cv::Scalar(0,255,255), 3);
+        if(found) {
+            cv::circle(out, bestTarget.Center(), 2, cv::Scalar(0,255,255), 3);
+        }
+
+        //and a ring where it is predicted to be when the message arrives
+        if(predicted) {
+            cv::circle(out, this->predictedTarget.Center(), 6, cv::Scalar(0,255,255), 1);
+        }
         
         out.copyTo(this->outputImage);
     }
@@ -321,6 +463,71 @@ double Runner::GetRunnerProperty(RunnerProperty prop) {
     return this->postprocessor.GetRunnerProperty(prop);
 }
 
+/**
+ * Preprocesses frame.region of frame.original in two levels. Candidate objects are found on a copy that is
+ * pyramidScale times smaller, and only the windows around them are preprocessed at full resolution.
+ * Everything else in frame.processed is left black. Falls back to preprocessing the whole region when 
+ * the candidates cover too much of it for the windows to save any work.
+ */
+void Runner::PreProcessPyramid(RunnerFrame &frame) {
+    cv::Mat searched = frame.original(frame.region);
+    cv::Size coarseSize = cv::Size(std::max(searched.cols / this->pyramidScale, 1), std::max(searched.rows / this->pyramidScale, 1));
+
+    //the buffers are kept in the workspace, so nothing here allocates once their sizes settle
+    cv::Mat &coarse = this->workspace.coarse,
+            &coarseMask = this->workspace.coarseMask;
+
+    cv::resize(searched, coarse, coarseSize, 0, 0, cv::INTER_AREA);
+    this->preprocessor.Segment(coarse, coarseMask);
+
+    std::vector< std::vector<cv::Point> > &candidates = this->workspace.candidates;
+    cv::findContours(coarseMask, candidates, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+    if(candidates.size() > MAX_PYRAMID_CANDIDATES) {
+        this->preprocessor.ProcessImage(searched, frame.processed);
+        return;
+    }
+
+    //windows are padded by a coarse pixel on each side plus enough room for erosion and dilation to see past the object
+    double scaleX = searched.cols / (double) coarseSize.width;
+    double scaleY = searched.rows / (double) coarseSize.height;
+    int padding = this->pyramidScale + 
+                  (int) this->preprocessor.GetProperty(PreProcessorProperty::EROSION) + 
+                  (int) this->preprocessor.GetProperty(PreProcessorProperty::DILATION);
+
+    cv::Rect searchedBounds = cv::Rect(0, 0, searched.cols, searched.rows);
+    std::vector<cv::Rect> &windows = this->workspace.windows;
+    windows.clear();
+    int windowArea = 0;
+    for(int i=0; i<candidates.size(); i++) {
+        cv::Rect coarseBounds = cv::boundingRect(candidates[i]);
+        cv::Rect window = cv::Rect(
+            (int) (coarseBounds.x * scaleX) - padding,
+            (int) (coarseBounds.y * scaleY) - padding,
+            (int) ceil(coarseBounds.width * scaleX) + (2 * padding),
+            (int) ceil(coarseBounds.height * scaleY) + (2 * padding)
+        ) & searchedBounds;
+
+        windows.push_back(window);
+        windowArea += window.area();
+    }
+
+    if(windowArea * 2 >= searchedBounds.area()) {
+        this->preprocessor.ProcessImage(searched, frame.processed);
+        return;
+    }
+
+    frame.processed.create(searched.rows, searched.cols, CV_8UC1);
+    frame.processed.setTo(cv::Scalar(0));
+
+    //windows can overlap, so combine them instead of overwriting
+    cv::Mat &windowMask = this->workspace.windowMask;
+    for(int i=0; i<windows.size(); i++) {
+        this->preprocessor.ProcessImage(searched(windows[i]), windowMask);
+        cv::Mat destination = frame.processed(windows[i]);
+        cv::bitwise_or(destination, windowMask, destination);
+    }
+}
+
 /**
  * Parses the XMLdocument doc and initalizes all runner settings and variables.
  * @param doc The XMLDocument to read.
@@ -345,8 +552,46 @@ void Runner::parseDocument(XMLDocument doc) {
             int resizeY = std::stoi(constResize.GetTagsByName("height")[0].Content());
             this->constantResize = Size(resizeX, resizeY);
 
+        //region tracking is optional and off unless the config turns it on
+        std::vector<XMLTag> regionTracking = config.GetTagsByName("regionTracking");
+        if(regionTracking.size() > 0) {
+            XMLTag tracking = regionTracking[0];
+            bool trackingEnabled = (tracking.GetAttributesByName("enabled")[0].Value() == "true");
+            int trackingPadding = std::stoi(tracking.GetTagsByName("padding")[0].Content());
+            int trackingRefresh = std::stoi(tracking.GetTagsByName("refresh")[0].Content());
+            this->regionTracker = RegionTracker(trackingEnabled, trackingPadding, trackingRefresh);
+        } else {
+            this->regionTracker = RegionTracker();
+        }
+
+        //target tracking is optional as well, and changes the message when it is on
+        std::vector<XMLTag> targetTracking = config.GetTagsByName("targetTracking");
+        if(targetTracking.size() > 0) {
+            XMLTag tracking = targetTracking[0];
+            bool trackingEnabled = (tracking.GetAttributesByName("enabled")[0].Value() == "true");
+            int trackingConfirm = std::stoi(tracking.GetTagsByName("confirm")[0].Content());
+            int trackingCoast = std::stoi(tracking.GetTagsByName("coast")[0].Content());
+            this->targetTracker = TargetTracker(trackingEnabled, trackingConfirm, trackingCoast);
+        } else {
+            this->targetTracker = TargetTracker();
+        }
+
+        //the pyramid is optional too. constantResize stays the resolution that targets are measured at
+        this->pyramidScale = 1;
+        std::vector<XMLTag> pyramid = config.GetTagsByName("pyramid");
+        if(pyramid.size() > 0 && pyramid[0].GetAttributesByName("enabled")[0].Value() == "true") {
+            this->pyramidScale = std::max(std::stoi(pyramid[0].GetTagsByName("scale")[0].Content()), 1);
+        }
+
         XMLTag preprocess = config.GetTagsByName("preprocessor")[0];
             bool preprocessorTypeIsFull = (preprocess.GetAttributesByName("type")[0].Value() == "full" ? true : false);
+
+            //morphology is optional; configs without it keep the original color-domain order.
+            bool preprocessorMaskMorphology = false;
+            std::vector<XMLTagAttribute> morphologyAttributes = preprocess.GetAttributesByName("morphology");
+            if(morphologyAttributes.size() > 0) {
+                preprocessorMaskMorphology = (morphologyAttributes[0].Value() == "mask");
+            }
             
             int preprocessorThreshold = std::stoi(preprocess.GetTagsByName("threshold")[0].Content());
             int preprocessorErosion = std::stoi(preprocess.GetTagsByName("erosion")[0].Content());
@@ -363,53 +608,239 @@ void Runner::parseDocument(XMLDocument doc) {
                 std::string udpAddr = udp.GetTagsByName("address")[0].Content();
                 int udpPort = std::stoi(udp.GetTagsByName("port")[0].Content());
 
-            XMLTag targetTag = postprocess.GetTagsByName("target")[0];
-            std::vector<XMLTag> targContours = targetTag.GetTagsByName("contour");
-            
-            int targetId = std::stoi(targetTag.GetAttributesByName("id")[0].Value());
-            std::vector<ExampleContour> contours;
-
-            //find all contours and populate the vector
-            for(int k=0; k<targContours.size(); k++) {
-                XMLTag contour = targContours[k];
-                int id = std::stoi(contour.GetAttributesByName("id")[0].Value());
-                double x = std::stod(contour.GetTagsByName("x")[0].Content());
-                double y = std::stod(contour.GetTagsByName("y")[0].Content());
-                double distXError = std::stod(contour.GetTagsByName("x")[0].GetAttributesByName("error")[0].Value());
-                double distYError = std::stod(contour.GetTagsByName("y")[0].GetAttributesByName("error")[0].Value());
-                int angle = std::stoi(contour.GetTagsByName("angle")[0].Content());
-                int angleError = std::stoi(contour.GetTagsByName("angle")[0].GetAttributesByName("error")[0].Value());
-                double solidity = std::stod(contour.GetTagsByName("solidity")[0].Content());
-                double solidError = std::stod(contour.GetTagsByName("solidity")[0].GetAttributesByName("error")[0].Value());
-                double ar = std::stod(contour.GetTagsByName("aspectRatio")[0].Content());
-                double arError = std::stod(contour.GetTagsByName("aspectRatio")[0].GetAttributesByName("error")[0].Value());
-                int minArea = std::stoi(contour.GetTagsByName("minimumArea")[0].Content());
-
-                SettingPair distXPair = SettingPair(x, distXError);
-                SettingPair distYPair = SettingPair(y, distYError);
-                SettingPair anglePair = SettingPair(angle, angleError);
-                SettingPair solidPair = SettingPair(solidity, solidError);
-                SettingPair arPair    = SettingPair(ar, arError);
-
-                ExampleContour newContour = ExampleContour(id, distXPair, distYPair, anglePair, arPair, solidPair, minArea);
-                contours.push_back(newContour);
-            }
+            //the age field is optional, because older robot code expects exactly seven fields
+            std::vector<XMLTag> sendAgeTags = udp.GetTagsByName("sendAge");
+            this->sendAge = (sendAgeTags.size() > 0 && sendAgeTags[0].Content() == "true");
 
-            //knownWidth, focalWidth, calibratedDistance, distErrorCorrect
-            double knownWidth = std::stod(targetTag.GetTagsByName("knownWidth")[0].Content());
-            double focalWidth = std::stod(targetTag.GetTagsByName("focalWidth")[0].Content());
-            double calibratedDistance = std::stod(targetTag.GetTagsByName("calibratedDistance")[0].Content());
-            double distErrorCorrect = std::stod(targetTag.GetTagsByName("distErrorCorrect")[0].Content());
+            //so is the binary protocol. Configs without it keep sending text
+            std::vector<XMLTag> protocolTags = udp.GetTagsByName("protocol");
+            this->sendBinary = (protocolTags.size() > 0 && protocolTags[0].Content() == "binary");
+
+            //messages can also go to dashboards, recorders, or multicast groups, like <destination port="5800">10.36.95.5</destination>
+            std::vector<XMLTag> destinationTags = udp.GetTagsByName("destination");
+            this->udpDestinations = std::vector<UDPDestination>();
+            for(int i=0; i<destinationTags.size(); i++) {
+                int destinationPort = std::stoi(destinationTags[i].GetAttributesByName("port")[0].Value());
+                this->udpDestinations.push_back(UDPDestination(destinationTags[i].Content(), destinationPort));
+            }
 
-            bool calcByHeight = targetTag.GetTagsByName("calcByHeight")[0].Content() == "true";
-            DistanceCalcMode distMode = (calcByHeight ? DistanceCalcMode::BY_HEIGHT : DistanceCalcMode::BY_WIDTH);
+            //every target is looked for in each frame. The first one is the one that is edited and sent.
+            std::vector<XMLTag> targetTags = postprocess.GetTagsByName("target");
+            std::vector<ExampleTarget> targets = std::vector<ExampleTarget>();
+            for(int i=0; i<targetTags.size(); i++) {
+                targets.push_back(this->parseTarget(targetTags[i]));
+            }
 
-            this->postProcessorTarget = ExampleTarget(targetId, contours, knownWidth, focalWidth, distErrorCorrect, calibratedDistance, distMode);
+            this->postProcessorTarget = targets[0];
 
     //init the preprocessor and postprocessor here
     this->preprocessor = PreProcessor(preprocessorTypeIsFull, preprocessorColor, preprocessorThreshold, preprocessorErosion, preprocessorDilation, this->debug);
-    this->postprocessor = PostProcessor(this->postProcessorTarget, this->debug);
+    this->preprocessor.SetProperty(PreProcessorProperty::MASK_MORPHOLOGY, (preprocessorMaskMorphology ? 1 : 0));
+    this->postprocessor = PostProcessor(targets, this->debug);
     KiwiLightApp::ReconnectUDP(udpAddr, udpPort);
+    KiwiLightApp::SetExtraUDPDestinations(this->udpDestinations);
+}
+
+/**
+ * Reads an ExampleTarget from a <target> tag in a configuration file.
+ * @param targetTag The tag to read.
+ */
+ExampleTarget Runner::parseTarget(XMLTag targetTag) {
+    std::vector<XMLTag> targContours = targetTag.GetTagsByName("contour");
+    
+    int targetId = std::stoi(targetTag.GetAttributesByName("id")[0].Value());
+    std::vector<ExampleContour> contours;
+
+    //find all contours and populate the vector
+    for(int k=0; k<targContours.size(); k++) {
+        XMLTag contour = targContours[k];
+        int id = std::stoi(contour.GetAttributesByName("id")[0].Value());
+        double x = std::stod(contour.GetTagsByName("x")[0].Content());
+        double y = std::stod(contour.GetTagsByName("y")[0].Content());
+        double distXError = std::stod(contour.GetTagsByName("x")[0].GetAttributesByName("error")[0].Value());
+        double distYError = std::stod(contour.GetTagsByName("y")[0].GetAttributesByName("error")[0].Value());
+        int angle = std::stoi(contour.GetTagsByName("angle")[0].Content());
+        int angleError = std::stoi(contour.GetTagsByName("angle")[0].GetAttributesByName("error")[0].Value());
+        double solidity = std::stod(contour.GetTagsByName("solidity")[0].Content());
+        double solidError = std::stod(contour.GetTagsByName("solidity")[0].GetAttributesByName("error")[0].Value());
+        double ar = std::stod(contour.GetTagsByName("aspectRatio")[0].Content());
+        double arError = std::stod(contour.GetTagsByName("aspectRatio")[0].GetAttributesByName("error")[0].Value());
+        int minArea = std::stoi(contour.GetTagsByName("minimumArea")[0].Content());
+
+        SettingPair distXPair = SettingPair(x, distXError);
+        SettingPair distYPair = SettingPair(y, distYError);
+        SettingPair anglePair = SettingPair(angle, angleError);
+        SettingPair solidPair = SettingPair(solidity, solidError);
+        SettingPair arPair    = SettingPair(ar, arError);
+
+        ExampleContour newContour = ExampleContour(id, distXPair, distYPair, anglePair, arPair, solidPair, minArea);
+        contours.push_back(newContour);
+    }
+
+    //knownWidth, focalWidth, calibratedDistance, distErrorCorrect
+    double knownWidth = std::stod(targetTag.GetTagsByName("knownWidth")[0].Content());
+    double focalWidth = std::stod(targetTag.GetTagsByName("focalWidth")[0].Content());
+    double calibratedDistance = std::stod(targetTag.GetTagsByName("calibratedDistance")[0].Content());
+    double distErrorCorrect = std::stod(targetTag.GetTagsByName("distErrorCorrect")[0].Content());
+
+    bool calcByHeight = targetTag.GetTagsByName("calcByHeight")[0].Content() == "true";
+    DistanceCalcMode distMode = (calcByHeight ? DistanceCalcMode::BY_HEIGHT : DistanceCalcMode::BY_WIDTH);
+
+    return ExampleTarget(targetId, contours, knownWidth, focalWidth, distErrorCorrect, calibratedDistance, distMode);
+}
+
+/**
+ * Returns where the robot center appears in the image when looking at "target". The camera is this->centerOffsetX 
+ * and this->centerOffsetY away from the center of the robot, which is a different number of pixels at every distance.
+ */
+cv::Point Runner::RobotCenterFor(Target &target) {
+    int trueCenterX = (this->constantResize.width / 2);
+    int trueCenterY = (this->constantResize.height / 2);
+
+    //find the offset center of the camera based on the target's distance
+    double inchesPerPixel = target.KnownWidth() / target.Bounds().width;
+    double centerInchesX = trueCenterX * inchesPerPixel;
+    double centerInchesY = trueCenterY * inchesPerPixel;
+
+    double offsetInchesX = centerInchesX - this->centerOffsetX;
+    double offestInchesY = centerInchesY - this->centerOffsetY;
+
+    //convert back to pixels
+    double offsetPixelsX = offsetInchesX / inchesPerPixel;
+    double offsetPixelsY = offestInchesY / inchesPerPixel;
+    return cv::Point((int) offsetPixelsX, (int) offsetPixelsY);
+}
+
+/**
+ * Appends the fields sent to the RIO for one target to "message": x, y, width, height, distance, 
+ * horizontal angle, and vertical angle, separated by commas.
+ * @param message The message to add to.
+ * @param target The target to describe.
+ * @param found True if there is a target. If false, "target" is ignored and the "nothing found" values are sent.
+ */
+void Runner::AppendTarget(MessageWriter &message, Target &target, bool found) {
+    int coordX   = -1,
+        coordY   = -1,
+        width    = -1,
+        height   = -1,
+        distance = -1,
+        HAngle   = 180,
+        VAngle   = 180;
+
+    if(found) {
+        cv::Point robotCenter = this->RobotCenterFor(target);
+        coordX = target.Center().x;
+        coordY = target.Center().y;
+        
+        width = target.Bounds().width;
+        height = target.Bounds().height;
+
+        distance = target.Distance();
+
+        HAngle = target.HorizontalAngle(distance, robotCenter.x);
+        VAngle = target.VerticalAngle(distance, robotCenter.y);
+    }
+
+    message.Append(coordX);
+    message.Append(',');
+    message.Append(coordY);
+    message.Append(',');
+    message.Append(width);
+    message.Append(',');
+    message.Append(height);
+    message.Append(',');
+    message.Append(distance);
+    message.Append(',');
+    message.Append(HAngle);
+    message.Append(',');
+    message.Append(VAngle);
+}
+
+/**
+ * Fills in this->workspace.packet for the last frame and encodes it. The sent target comes first, then its 
+ * prediction when tracking, then the rest of the targets in the frame until the packet is full.
+ * @param frame The frame the packet describes.
+ * @param sentTarget The target that the text message describes.
+ * @param found True if there is a sent target.
+ * @param predicted True if this->predictedTarget holds a prediction of the sent target.
+ * @param sentIndex The index of the sent target in frame.targets, or -1.
+ */
+void Runner::BuildPacket(RunnerFrame &frame, Target &sentTarget, bool found, bool predicted, int sentIndex) {
+    TargetPacket &packet = this->workspace.packet;
+    packet.Clear(this->packetSequence++, frame.timestamp, this->lastFrameLatency);
+
+    bool tracking = this->targetTracker.Enabled();
+    int trackedFlag = (tracking ? TargetPacket::TRACKED : 0);
+    if(found) {
+        packet.Add(this->MakePacketTarget(sentTarget, TargetPacket::SENT | trackedFlag));
+    }
+
+    if(predicted) {
+        packet.Add(this->MakePacketTarget(this->predictedTarget, TargetPacket::PREDICTED | trackedFlag));
+    }
+
+    //a tracked target is an estimate, so the target it was last seen as is still sent as it was seen
+    for(int i=0; i<frame.targets.size(); i++) {
+        if(i == sentIndex && !tracking) {
+            continue;
+        }
+
+        if(!packet.Add(this->MakePacketTarget(frame.targets[i], 0))) {
+            break;
+        }
+    }
+
+    packet.Encode(this->workspace.packetBytes);
+}
+
+/**
+ * Fills in this->workspace.packet with no targets and encodes it, for when there is no frame to describe.
+ * It is stamped with the current time and no latency, since there is no capture time.
+ */
+void Runner::BuildEmptyPacket() {
+    TargetPacket &packet = this->workspace.packet;
+    packet.Clear(this->packetSequence++, Clock::GetMonotonicTime(), 0);
+    packet.Encode(this->workspace.packetBytes);
+}
+
+/**
+ * Describes "target" the way a TargetPacket sends it.
+ * @param flags The TargetPacket flags of the target.
+ */
+PacketTarget Runner::MakePacketTarget(Target &target, int flags) {
+    cv::Point robotCenter = this->RobotCenterFor(target);
+    cv::Rect bounds = target.Bounds();
+    double distance = target.Distance();
+
+    PacketTarget packetTarget;
+    packetTarget.id = target.ID();
+    packetTarget.flags = flags;
+    packetTarget.x = target.Center().x;
+    packetTarget.y = target.Center().y;
+    packetTarget.width = bounds.width;
+    packetTarget.height = bounds.height;
+    packetTarget.distance = distance;
+    packetTarget.horizontalAngle = target.HorizontalAngleDegrees(distance, robotCenter.x);
+    packetTarget.verticalAngle = target.VerticalAngleDegrees(distance, robotCenter.y);
+    packetTarget.fit = target.Fit();
+    return packetTarget;
+}
+
+/**
+ * Returns what should be sent to the RIO for the last frame given to FinishFrame(): the encoded TargetPacket 
+ * if the config uses the binary protocol, or the text message otherwise. Only valid until the next frame is finished.
+ */
+const std::string &Runner::GetLastFramePacket() {
+    if(this->sendBinary) {
+        //a config that sends binary never sends text, even before its first frame
+        if(this->workspace.packetBytes.empty()) {
+            this->BuildEmptyPacket();
+        }
+
+        return this->workspace.packetBytes;
+    }
+
+    return (this->lastFrameCaptured ? this->workspace.message : NULL_MESSAGE);
 }
 
 /**
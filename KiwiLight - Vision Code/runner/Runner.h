@@ -1,6 +1,17 @@
 #ifndef KiwiLight_RUNNER_H
 #define KiwiLight_RUNNER_H
 
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <climits>
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+#include <dirent.h>
+#include <cstdint>
+#include <cstring>
 #include "Settings.h"
 #include "../util/Util.h"
 #include "opencv2/opencv.hpp"
@@ -48,7 +59,20 @@ namespace KiwiLight {
         COLOR_HUE,
         COLOR_SATURATION,
         COLOR_VALUE,
-        COLOR_ERROR
+        COLOR_ERROR,
+        MASK_MORPHOLOGY
+    };
+
+    /**
+     * Implementations of the ColorClassifier's per-pixel loop.
+     */
+    enum ClassifierKernel {
+        KERNEL_AUTO,   //fastest kernel the CPU supports
+        KERNEL_SCALAR, //portable, works everywhere
+        KERNEL_SSSE3,
+        KERNEL_AVX2,
+        KERNEL_NEON,
+        NUMBER_OF_KERNELS
     };
 
     /**
@@ -101,7 +125,8 @@ namespace KiwiLight {
     class Contour {
         public:
         Contour() {};
-        Contour(std::vector<cv::Point> points);
+        Contour(const std::vector<cv::Point> &points);
+        Contour(int x, int y, int width, int height, int angle, double solidity);
         int X()        { return this->x;      };
         int Y()        { return this->y;      };
         Point Center() { return this->center; };
@@ -113,7 +138,6 @@ namespace KiwiLight {
         double Solidity()    { return this->solidity;    };
 
         private:
-        std::vector<cv::Point> points;
         int x,
             y,
             width,
@@ -125,6 +149,29 @@ namespace KiwiLight {
         Point center;
     };
 
+    /**
+     * The features of every contour found in a frame, stored column by column so that ExampleContours can 
+     * test all of them at once in tight loops. Contours are referred to by their row number.
+     */
+    struct ContourTable {
+        void Clear();
+        void Add(Contour contour);
+        int Size() { return this->x.size(); };
+        Contour Get(int row);
+        cv::Rect Bounds(const int *rows, int count);
+
+        std::vector<int> x,
+                         y,
+                         width,
+                         height;
+
+        //features that ExampleContours test, kept as doubles so the tests are plain range checks
+        std::vector<double> angle,
+                            area,
+                            aspectRatio,
+                            solidity;
+    };
+
     /**
      * A imaginary template for a real contour. This class compares Contours with itself and can tell if a contour can "represent" itself.
      */
@@ -141,6 +188,8 @@ namespace KiwiLight {
                        int minimumArea);
 
         bool IsContour(Contour contour);
+        void TestContours(ContourTable &table, unsigned char *passed);
+        bool MightBeContour(int width, int height);
         int ID() { return this->id; };
         SettingPair DistX()       { return this->distX; };
         SettingPair DistY()       { return this->distY; };
@@ -173,24 +222,34 @@ namespace KiwiLight {
     class Target {
         public:
         Target();
-        Target(int id, std::vector<Contour> contours, double knownHeight, double focalHeight, double distErrorCorrect, double calibratedDistance, DistanceCalcMode distMode);
+        Target(int id, const std::vector<Contour> &contours, double knownHeight, double focalHeight, double distErrorCorrect, double calibratedDistance, DistanceCalcMode distMode);
+        static cv::Rect BoundsOf(const Contour *contours, int count);
+        void Set(int id, const Contour *contours, int count, double knownHeight, double focalHeight, double distErrorCorrect, double calibratedDistance, DistanceCalcMode distMode);
+        void Set(int id, ContourTable &table, const int *rows, int count, double knownHeight, double focalHeight, double distErrorCorrect, double calibratedDistance, DistanceCalcMode distMode);
         int ID() { return this->id; };
         std::vector<Contour> Contours() { return this->contours; };
         double Distance();
         double Distance(DistanceCalcMode mode);
         int HorizontalAngle(int imageCenterX);
         int HorizontalAngle(double distanceToTarget, int imageCenterX);
+        double HorizontalAngleDegrees(double distanceToTarget, int imageCenterX);
         int VerticalAngle(int imageCenterY);
         int VerticalAngle(double distanceToTarget, int imageCenterY);
+        double VerticalAngleDegrees(double distanceToTarget, int imageCenterY);
         int ObliqueAngle(int imageCenterX, int imageCenterY);
         double KnownWidth() { return this->knownHeight; };
         double FocalWidth() { return this->focalHeight; };
         double DistanceErrorCorrection() { return this->distErrorCorrect; };
         double CalibratedDistance() { return this->calibratedDistance; };
+        double Fit() { return this->fit; };
+        void SetFit(double fit) { this->fit = fit; };
+        void SetBounds(cv::Rect bounds);
         cv::Point Center() { return cv::Point(this->x, this->y); };
         cv::Rect Bounds();
 
         private:
+        void Measure(int id, double knownHeight, double focalHeight, double distErrorCorrect, double calibratedDistance, DistanceCalcMode distMode);
+
         std::vector<Contour> contours;
 
         int id,
@@ -202,22 +261,124 @@ namespace KiwiLight {
         double knownHeight,
                focalHeight,
                distErrorCorrect,
-               calibratedDistance;
+               calibratedDistance,
+               fit;
 
         DistanceCalcMode distMode;
     };
 
+    /**
+     * Searches a ContourTable for groups of contours that fit an ExampleTarget, giving each contour in a group the
+     * role of one of the target's ExampleContours. Partial groups are dropped as soon as the DistX and DistY ranges
+     * of their roles can't all be met, and the contours for the next role are only looked for in the grid cells
+     * that those ranges allow.
+     */
+    class TargetMatcher {
+        public:
+        static const int MAX_EXPANSIONS;
+        static const int MAX_GRID_SIDE;
+        static const double WIDTH_SLACK;
+        static const int MAX_ASSIGNED_ROLES;
+        static const int MAX_FIXED_ROLES;
+
+        typedef int (TargetMatcher::*BestGroupsMethod)(ArenaVector<int> &groups, ArenaVector<double> &fits, int maxGroups);
+        static BestGroupsMethod BestGroupsFor(int numberOfRoles);
+
+        TargetMatcher(std::vector<ExampleContour> &roles, ContourTable &table, const unsigned char *accepted, const int *validRows, int numberOfValidRows, FrameArena &arena);
+        
+        //ROLES is the number of contours in the target, or 0 to work with any number. See BestGroupsFor().
+        template<int ROLES> int FindGroups(ArenaVector<int> &groups, ArenaVector<double> &fits);
+        template<int ROLES> int FindBestGroups(ArenaVector<int> &groups, ArenaVector<double> &fits, int maxGroups);
+        bool Capped() { return this->capped; };
+
+        private:
+        template<int ROLES> int RoleCount() { return (ROLES > 0 ? ROLES : this->numberOfRoles); };
+        template<int ROLES> void Place(int depth, int row);
+        template<int ROLES> void Extend(int depth);
+        template<int ROLES> void Report();
+        template<int ROLES> void ScoreGroup();
+        template<int ROLES> double Assign();
+        bool Expand();
+        int ColumnOf(int x);
+        int RowOf(int y);
+        int CellOf(int x, int y);
+
+        FrameArena *arena;
+        ContourTable *table;
+        const unsigned char *accepted;
+        const int *validRows;
+        int numberOfValidRows,
+            numberOfRoles,
+            numberOfRows;
+
+        //DistX and DistY ranges of each role
+        double *lowerX,
+               *upperX,
+               *lowerY,
+               *upperY;
+
+        //the order that roles are filled in, and the row placed in each role
+        int *order,
+            *chosen;
+
+        //how far each row's angle, aspect ratio, and solidity are from what each role wants, summed
+        double *shapeDeviations;
+
+        //the scores of the placed group (see ScoreGroup()), and room for Assign()
+        int *sortedRows;
+        double *scores;
+        int *assigned;
+        double *bestTotals;
+        int *lastMembers;
+
+        //per depth: the range of widths the target can still have, and the left edges of the placed contours
+        double *widthLower,
+               *widthUpper;
+
+        int *leftMin,
+            *leftMax;
+
+        int *centerX,
+            *centerY;
+
+        unsigned char *used;
+        int greatestWidth;
+
+        //valid rows bucketed by center. The rows in cell c are cellRows[cellStart[c]] to cellRows[cellStart[c + 1] - 1]
+        int *cellStart,
+            *cellRows;
+
+        int gridColumns,
+            gridRows,
+            gridX,
+            gridY,
+            cellWidth,
+            cellHeight;
+
+        ArenaVector<int> *groups;
+        ArenaVector<double> *fits;
+        int groupsFound,
+            expansions;
+
+        bool capped;
+    };
+
     /**
      * An imaginary template for a real Target.
      * This class does most of the PostProcessor's heavy lifting, specifically picking Targets out of groups of Contours.
      */
     class ExampleTarget {
         public:
-        ExampleTarget() {};
+        static const int MAX_TARGETS;
+
+        ExampleTarget() : findBestGroups(TargetMatcher::BestGroupsFor(0)) {};
         ExampleTarget(int id, std::vector<ExampleContour> contours, double knownHeight, double focalHeight, double distErrorCorrect, double calibratedDistance, DistanceCalcMode mode);
-        std::vector<Target> GetTargets(std::vector<Contour> contours);
-        bool isTarget(std::vector<Contour> contours);
-        std::vector<Contour> GetValidContours(std::vector<Contour> contours);
+        std::vector<Target> GetTargets(const std::vector<Contour> &contours);
+        void GetTargets(ContourTable &table, std::vector<Target> &targets, FrameArena &arena);
+        bool isTarget(const std::vector<Contour> &contours);
+        bool MightHaveContour(int width, int height);
+        std::vector<Contour> GetValidContours(const std::vector<Contour> &contours);
+        std::vector<Contour> GetValidContours(ContourTable &table);
         int ID() { return this->id; };
         std::vector<ExampleContour> Contours() { return this->contours; };
         ExampleContour GetExampleContourByID(int id);
@@ -225,18 +386,20 @@ namespace KiwiLight {
         SettingPair GetContourProperty(int contour, TargetProperty prop);
         void SetTargetProperty(RunnerProperty prop, double value);
         double GetTargetProperty(RunnerProperty prop);
+        XMLTag EncodeXMLTag();
 
         //DEPRECATED
         [[deprecated("This method is no longer used and will be removed in the next update.")]] 
         void AddGenericContour();
 
         private:
-        bool ArrayMaxed(int arr[], int size, int max);
-        bool ContainsDuplicates(int arr[], int size);
-        bool CombonationAlreadyTested(int combonation[], std::vector< std::vector<int> > testedCombos, int comboSize);
+        void TestContours(ContourTable &table, ArenaVector<unsigned char> &accepted, ArenaVector<int> &validRows);
         int id;
         std::vector<ExampleContour> contours;
 
+        //picked for the number of contours when the target is made
+        TargetMatcher::BestGroupsMethod findBestGroups;
+
         double knownHeight,
                focalHeight,
                distErrorCorrect,
@@ -245,6 +408,94 @@ namespace KiwiLight {
         DistanceCalcMode distMode;
     };
 
+    /**
+     * Decides which pixels of a BGR image are the target color, without converting the image to HSV.
+     * Each channel is thresholded first, which leaves only 8 possible colors, so the whole decision is 
+     * precomputed into lookup tables whenever the color or threshold changes.
+     */
+    class ColorClassifier {
+        public:
+        static const int HUE_RANGE;
+        static const std::string KERNEL_NAMES[NUMBER_OF_KERNELS];
+
+        static bool KernelSupported(ClassifierKernel kernel);
+        static bool SetKernel(std::string name);
+        static ClassifierKernel GetKernel();
+
+        ColorClassifier() {};
+        ColorClassifier(Color targetColor, double threshold);
+        void Classify(const cv::Mat &img, cv::Mat &mask) const;
+        void Classify(const cv::Mat &img, cv::Mat &mask, ClassifierKernel kernel) const;
+
+        private:
+        static ClassifierKernel kernel;
+
+        void ClassifyRowScalar(const uchar *in, uchar *out, int width) const;
+        void ClassifyRowSSSE3(const uchar *in, uchar *out, int width) const;
+        void ClassifyRowAVX2(const uchar *in, uchar *out, int width) const;
+        void ClassifyRowNEON(const uchar *in, uchar *out, int width) const;
+
+        uchar threshold;           //channel values above this count as bright
+        uchar channelBits[3][256]; //bit that each channel value contributes to a pixel's class
+        uchar classMask[16];       //mask value for each combination of thresholded channels. Padded for table lookup instructions
+    };
+
+    /**
+     * Erodes and dilates binary masks with square kernels, working on 64 pixels at a time by packing 
+     * each pixel into a single bit. Gives the same result as cv::erode() and cv::dilate().
+     */
+    class BinaryMorphology {
+        public:
+        static const int MAX_KERNEL_SIZE;
+
+        BinaryMorphology() {};
+        void Apply(const cv::Mat &mask, cv::Mat &out, int erosion, int dilation);
+
+        private:
+        void Pack(const cv::Mat &mask);
+        void Unpack(cv::Mat &out);
+        void Filter(int size, bool eroding);
+
+        int rows,
+            cols,
+            wordsPerRow;
+        std::vector<uint64_t> 
+            packed,
+            scratch;
+    };
+
+    /**
+     * Everything the PreProcessor needs to process a frame, built once from its settings.
+     * A plan is never changed after it is built, so a frame can keep using it while a new one replaces it.
+     */
+    struct PreProcessorPlan {
+        PreProcessorPlan(bool fullPreprocessor, bool maskMorphology, Color targetColor, double threshold, int erosion, int dilation);
+
+        bool isFullPreprocessor,
+             maskMorphology;
+
+        int erode,
+            dilate;
+
+        cv::Mat erodeKernel,
+                dilateKernel;
+
+        ColorClassifier classifier; //lookup tables for the target color and threshold
+    };
+
+    /**
+     * Buffers that a PreProcessor reuses from frame to frame. Copies start out empty, so 
+     * two copies of a PreProcessor never write into the same image.
+     */
+    struct PreProcessorScratch {
+        PreProcessorScratch() {};
+        PreProcessorScratch(const PreProcessorScratch &other) {};
+        PreProcessorScratch &operator=(const PreProcessorScratch &other) { return *this; };
+
+        cv::Mat filtered; //eroded and dilated color image
+        BinaryMorphology morphology;
+    };
+
     /**
      * A module which takes raw images and gets them ready for work by the PostProcessor.
      */
@@ -255,9 +506,13 @@ namespace KiwiLight {
         void SetProperty(PreProcessorProperty prop, double value);
         double GetProperty(PreProcessorProperty prop);
         cv::Mat ProcessImage(cv::Mat img);
+        void ProcessImage(const cv::Mat &img, cv::Mat &out);
+        void Segment(const cv::Mat &img, cv::Mat &out);
         std::string toString();
 
         private:
+        void Compile();
+
         bool isFullPreprocessor,
              debugging;
 
@@ -271,48 +526,82 @@ namespace KiwiLight {
         int dilate,
             erode;
         
+        //true to erode and dilate the mask after finding the color, false to erode and dilate the image before
+        bool maskMorphology;
+
         //what the camera looks for
         Color targetColor;
+
+        std::shared_ptr<const PreProcessorPlan> plan; //only replaced with std::atomic_store()
+        PreProcessorScratch scratch;
+    };
+
+    /**
+     * What a PostProcessor needs to search for several targets at once: threads, and an arena and list of results for 
+     * each target after the first. Copies start out empty and are filled in when they are first used.
+     */
+    struct PostProcessorWorkers {
+        PostProcessorWorkers() {};
+        PostProcessorWorkers(const PostProcessorWorkers &other) {};
+        PostProcessorWorkers &operator=(const PostProcessorWorkers &other) { return *this; };
+
+        std::unique_ptr<ThreadPool> pool;
+        std::vector<FrameArena> arenas;
+        std::vector< std::vector<Target> > results;
     };
 
     /**
      * Takes preprocessed images and finds targets within them.
+     * Contours are found once per image, and every ExampleTarget is searched for in the same contours.
      */
     class PostProcessor {
         public:
         PostProcessor() {};
         PostProcessor(ExampleTarget target, bool debugging);
+        PostProcessor(std::vector<ExampleTarget> targets, bool debugging);
         void SetTarget(ExampleTarget target);
+        void SetTarget(int id, ExampleTarget target);
+        int NumberOfTargets();
         int NumberOfContours();
+        int NumberOfContours(int target);
         std::vector<Target> ProcessImage(cv::Mat img);
+        std::vector<Target> ProcessImage(cv::Mat img, cv::Point offset);
+        void ProcessImage(cv::Mat img, cv::Point offset, std::vector<Target> &targets, FrameArena &arena);
         std::vector<Contour> GetValidContoursForTarget(std::vector<Contour> contours);
+        std::vector<Contour> GetValidContoursForTarget(ContourTable &contours);
         void SetTargetContourProperty(int contour, TargetProperty prop, SettingPair values);
         SettingPair GetTargetContourProperty(int contour, TargetProperty prop);
         void SetRunnerProperty(RunnerProperty prop, double value);
         double GetRunnerProperty(RunnerProperty prop);
         ExampleTarget GetTarget();
-        std::vector<Contour> GetContoursFromLastFrame() { return this->contoursFromLastFrame; };
-
-        //DEPRECATED STUFF
-        [[deprecated("Use PostProcessor(ExampleTarget, bool) instead.")]] 
-        PostProcessor(std::vector<ExampleTarget> targets, bool debugging); //deprecated
-
-        [[deprecated("Use SetTarget(ExampleTarget) instead.")]] 
-        void SetTarget(int id, ExampleTarget target); //deprecated
-
-        [[deprecated("The PostProcessor will no longer support multi-targeting.")]] 
-        int NumberOfTargets(); //deprecated
-
-        [[deprecated("PostProcessor is moving away from using multiple targets. Use NumberOfContours() instead.")]] 
-        int NumberOfContours(int target); //deprecated
-
-        [[deprecated("PostProcessor is moving away from using multiple targets. use GetTarget() instead.")]] 
-        ExampleTarget GetExampleTargetByID(int id); //deprecated
+        ExampleTarget GetExampleTargetByID(int id);
+        std::vector<ExampleTarget> GetTargets();
+        const ContourTable &GetContoursFromLastFrame() { return this->contoursFromLastFrame; };
 
         private:
+        bool MightHaveContour(int width, int height);
+        cv::Rect LabelBounds(int label);
+        bool InsideHole(cv::Mat img, int label, cv::Rect bounds, int numberOfLabels);
+        void FindAllTargets(std::vector<Target> &targets, FrameArena &arena);
+
         bool debugging;
-        ExampleTarget target;
-        std::vector<Contour> contoursFromLastFrame;
+        ExampleTarget target;              //the target that is edited and sent
+        std::vector<ExampleTarget> others; //any more targets to look for in the same contours
+        PostProcessorWorkers workers;
+        ContourTable contoursFromLastFrame;
+        std::vector< std::vector<cv::Point> > contourPoints; //kept between frames so findContours() can reuse its vectors
+
+        //connected component labels and statistics, kept between frames so their buffers are reused
+        cv::Mat labels,
+                stats,
+                centroids,
+                blobMask,
+                backgroundMask,
+                backgroundLabels;
+
+        std::vector<uchar> keepLabel;        //255 for each label whose blob gets a contour
+        std::vector<bool> outsideBackground; //true for each background label that reaches the edge of the image
+        bool backgroundLabeled;              //true once the background of the current image has been labeled
     };
 
     /**
@@ -334,6 +623,347 @@ namespace KiwiLight {
         Mat image;
     };
 
+    /**
+     * One captured image, shared read-only by everything that processes it. Copies of a SharedFrame 
+     * all point to the same image, which is freed when the last copy goes away.
+     */
+    struct SharedFrame {
+        SharedFrame() : id(-1), timestamp(0) {};
+        SharedFrame(long id, cv::Mat image) : SharedFrame(id, image, Clock::GetMonotonicTime()) {};
+        SharedFrame(long id, cv::Mat image, long long timestamp) : id(id), timestamp(timestamp), image(std::make_shared<const cv::Mat>(image)) {};
+        SharedFrame(long id, std::shared_ptr<const cv::Mat> image, long long timestamp) : id(id), timestamp(timestamp), image(image) {};
+        bool Valid() const { return this->image && !this->image->empty(); };
+
+        long id; //increases with every new frame. -1 if nothing was captured
+        long long timestamp; //when the frame was captured, from Clock::GetMonotonicTime()
+        std::shared_ptr<const cv::Mat> image;
+    };
+
+    /**
+     * Image buffers for SharedFrames. A buffer is reused once no SharedFrame points to it anymore, so copying 
+     * frames stops allocating once there are as many buffers as frames in use at the same time.
+     */
+    class SharedFramePool {
+        public:
+        SharedFrame Copy(long id, const cv::Mat &image, long long timestamp);
+
+        private:
+        std::vector< std::shared_ptr<cv::Mat> > buffers;
+    };
+
+    /**
+     * Grabs frames from a camera on its own thread so that capturing and processing can happen at the same time.
+     * The newest frame is always handed to the processing side, and frames that were never used are dropped.
+     */
+    class FrameGrabber {
+        public:
+        static const int STALE_FRAME_WAIT_MS;
+
+        FrameGrabber();
+        ~FrameGrabber();
+        void Start(VideoCapture *camera);
+        void Stop();
+        bool Running() { return this->running.load(); };
+        bool Latest(cv::Mat &frame);
+        SharedFrame Shared(long afterId);
+        long FramesCaptured() { return this->ring.FramesPublished(); };
+        long FramesDropped() { return this->ring.FramesDropped(); };
+        long FramesDuplicated() { return this->ring.FramesDuplicated(); };
+        long CaptureFailures() { return this->captureFailures.load(); };
+        std::string Summary();
+
+        private:
+        void CaptureLoop();
+
+        VideoCapture *camera;
+        FrameRing ring;
+        SharedFramePool framePool; //buffers for the copies in "newest"
+        SharedFrame newest;
+        std::thread captureThread;
+        std::atomic<bool> running;
+        std::atomic<long> captureFailures;
+
+        std::mutex 
+            consumerLock,
+            frameLock;
+        std::condition_variable frameReady;
+    };
+
+    /**
+     * Somewhere Runners get their frames from, such as the camera or a video file.
+     */
+    class FrameSource {
+        public:
+        static const int DEFAULT_PRELOAD_DEPTH;
+
+        virtual ~FrameSource() {};
+        virtual SharedFrame Next(long afterId) = 0;
+        virtual bool Finished() = 0;
+        virtual bool Live() { return false; };
+        virtual std::string Describe() = 0;
+
+        /**
+         * Sets how many consumers, such as the capture stages of several RunnerPipelines, take frames from this source.
+         * Sources that read one frame after another hand every frame to every consumer. Live sources ignore this, 
+         * because each consumer should get the newest frame.
+         */
+        virtual void SetConsumers(int consumers) {};
+
+        static std::shared_ptr<FrameSource> Create(std::string description);
+    };
+
+    /**
+     * Takes frames from KiwiLight's camera.
+     */
+    class CameraFrameSource : public FrameSource {
+        public:
+        SharedFrame Next(long afterId);
+        bool Finished() { return false; };
+        bool Live() { return true; };
+        std::string Describe() { return "camera"; };
+    };
+
+    /**
+     * The frame that a source reading its frames one after another is handing out. The next frame is only read 
+     * once every consumer has taken the current one, so consumers that run at different speeds all see the 
+     * same frames, in the same order.
+     */
+    class LockStepFrame {
+        public:
+        LockStepFrame();
+        SharedFrame Next(long afterId, std::function<bool(SharedFrame&)> read);
+        void SetConsumers(int consumers);
+        bool Finished() { return this->finished.load(); };
+
+        private:
+        SharedFrame current;
+        int consumers,
+            taken; //the number of consumers that have taken the current frame
+        std::atomic<bool> finished;
+        std::mutex frameLock;
+        std::condition_variable frameTaken;
+    };
+
+    /**
+     * A source that reads its frames one after another, such as a file on disk. Frames are read as 
+     * fast as they are asked for, so a whole recording can be processed at full speed.
+     */
+    class FileFrameSource : public FrameSource {
+        public:
+        FileFrameSource();
+        SharedFrame Next(long afterId);
+        bool Finished() { return this->frame.Finished(); };
+        void SetConsumers(int consumers) { this->frame.SetConsumers(consumers); };
+
+        protected:
+        virtual cv::Mat ReadFrame() = 0;
+        virtual long long LastFrameTimestamp() { return Clock::GetMonotonicTime(); };
+
+        private:
+        LockStepFrame frame;
+        long lastFrameId;
+    };
+
+    /**
+     * Reads frames from a video file.
+     */
+    class VideoFrameSource : public FileFrameSource {
+        public:
+        VideoFrameSource(std::string fileName);
+        std::string Describe() { return "video:" + this->fileName; };
+
+        protected:
+        cv::Mat ReadFrame();
+
+        private:
+        std::string fileName;
+        VideoCapture video;
+    };
+
+    /**
+     * Reads the images in a directory in file name order, or a single image file.
+     */
+    class ImageFrameSource : public FileFrameSource {
+        public:
+        ImageFrameSource(std::string path, bool loop);
+        std::string Describe() { return "images:" + this->path; };
+
+        protected:
+        cv::Mat ReadFrame();
+
+        private:
+        std::string path;
+        std::vector<std::string> files;
+        int nextFile;
+        bool loop;
+        cv::Mat lastImage;
+    };
+
+    /**
+     * Reads frames from another FrameSource on a background thread, so that decoding the next 
+     * frames overlaps with processing the current one.
+     */
+    class PreloadingFrameSource : public FrameSource {
+        public:
+        PreloadingFrameSource(std::shared_ptr<FrameSource> source, int depth);
+        ~PreloadingFrameSource();
+        SharedFrame Next(long afterId);
+        bool Finished() { return this->frame.Finished(); };
+        bool Live() { return this->source->Live(); };
+        std::string Describe() { return this->source->Describe(); };
+        void SetConsumers(int consumers) { this->frame.SetConsumers(consumers); };
+
+        private:
+        void PreloadLoop();
+
+        std::shared_ptr<FrameSource> source;
+        SPSCQueue<SharedFrame> preloaded;
+        LockStepFrame frame;
+        std::atomic<bool> running;
+        std::thread preloadThread;
+    };
+
+    /**
+     * Starts each chunk of a raw recording. See FrameRecorder for the layout of the file.
+     */
+    struct RecordingChunkHeader {
+        uint32_t magic;
+        uint32_t frames;
+        uint32_t session; //which run of a FrameRecorder wrote the chunk, counting from 0
+        uint32_t reserved;
+        uint64_t bytes;   //size of the frames that follow, headers included
+    };
+
+    /**
+     * Comes before the pixels of each frame in a raw recording.
+     */
+    struct RecordingFrameHeader {
+        int64_t timestamp; //when the frame was captured, from Clock::GetMonotonicTime()
+        int64_t id;
+        int32_t rows,
+                cols,
+                type,
+                rowBytes; //size of one row of pixels
+    };
+
+    /**
+     * Locates one frame of a raw recording.
+     */
+    struct RecordingIndexEntry {
+        int64_t timestamp;
+        uint64_t offset;  //position of the frame's RecordingFrameHeader in the recording
+        uint32_t session; //the session of the frame's chunk
+        uint32_t reserved;
+    };
+
+    /**
+     * Records every new frame of another FrameSource to a raw recording while passing the frames along.
+     * Frames are written by a background thread. If the writer falls behind, frames are dropped from the 
+     * recording instead of slowing down the Runners.
+     * 
+     * A recording starts with FILE_MAGIC and is followed by chunks. Each chunk is a RecordingChunkHeader 
+     * followed by its frames, and each frame is a RecordingFrameHeader followed by the frame's pixels, row 
+     * after row. Next to the recording, "<file>.idx" starts with INDEX_MAGIC and holds one RecordingIndexEntry 
+     * per frame. Both files are only ever appended to. Numbers are in the byte order of the recording machine.
+     * 
+     * Each FrameRecorder writing to a file starts a new session. Timestamps start over when the machine restarts, 
+     * so they are only in order within a session. Before a session is appended, a chunk left cut short by a 
+     * crash is cut off the end of the recording, and the index is rebuilt if it does not match the recording.
+     */
+    class FrameRecorder : public FrameSource {
+        public:
+        static const int DEFAULT_QUEUE_DEPTH;
+        static const int CHUNK_FRAMES;
+        static const char 
+            FILE_MAGIC[8],
+            INDEX_MAGIC[8];
+        static const uint32_t CHUNK_MAGIC;
+
+        FrameRecorder(std::shared_ptr<FrameSource> source, std::string fileName, int queueDepth);
+        ~FrameRecorder();
+        SharedFrame Next(long afterId);
+        bool Finished() { return this->source->Finished(); };
+        bool Live() { return this->source->Live(); };
+        std::string Describe() { return this->source->Describe(); };
+        void SetConsumers(int consumers) { this->source->SetConsumers(consumers); };
+        void Stop();
+        std::shared_ptr<FrameSource> GetSource() { return this->source; };
+        long FramesWritten() { return this->framesWritten.load(); };
+        long FramesDropped() { return this->framesDropped.load(); };
+        std::string Summary();
+
+        private:
+        void WriteLoop();
+        bool WriteChunk(std::vector<SharedFrame> &chunk);
+
+        std::shared_ptr<FrameSource> source;
+        std::string fileName;
+        std::ofstream 
+            recordingFile,
+            indexFile;
+        uint64_t recordingSize;
+        std::atomic<bool> writing;
+
+        bool Resume();
+
+        uint32_t session; //the session this recorder writes
+        SPSCQueue<SharedFrame> unwritten;
+        long lastRecordedId;
+        std::mutex recordLock;
+        std::thread writeThread;
+        std::atomic<long> 
+            framesWritten,
+            framesDropped;
+    };
+
+    /**
+     * Reads frames out of a raw recording made by a FrameRecorder, in order or by timestamp.
+     * If the index is missing or was cut short, it is rebuilt from the recording itself.
+     */
+    class FrameRecording {
+        public:
+        FrameRecording(std::string fileName);
+        bool IsOpen() { return this->recordingFile.is_open(); };
+        int NumberOfFrames() { return this->entries.size(); };
+        long long Timestamp(int frame) { return this->entries[frame].timestamp; };
+        int Session(int frame) { return this->entries[frame].session; };
+        int LastSession() { return (this->entries.size() > 0 ? (int) this->entries.back().session : -1); };
+        int Seek(int session, long long timestamp);
+        bool Read(int frame, cv::Mat &image);
+        uint64_t CompleteSize() { return this->completeSize; };
+        bool IndexRebuilt() { return this->indexRebuilt; };
+        bool SaveIndex(std::string indexFileName);
+
+        private:
+        bool LoadIndex(std::string indexFileName);
+        void RebuildIndex();
+
+        std::ifstream recordingFile;
+        uint64_t recordingSize,
+                 completeSize; //size of the recording up to the end of its last complete chunk
+        bool indexRebuilt;
+        std::vector<RecordingIndexEntry> entries;
+    };
+
+    /**
+     * Replays a raw recording made by a FrameRecorder. Frames keep the timestamps they were recorded with.
+     */
+    class RecordingFrameSource : public FileFrameSource {
+        public:
+        RecordingFrameSource(std::string fileName);
+        std::string Describe() { return "raw:" + this->fileName; };
+
+        protected:
+        cv::Mat ReadFrame();
+        long long LastFrameTimestamp() { return this->lastTimestamp; };
+
+        private:
+        std::string fileName;
+        FrameRecording recording;
+        int nextFrame;
+        long long lastTimestamp;
+    };
+
     /**
      * Utility which logs Runner activity into a log file which can be read by a LogViewer.
      */
@@ -377,12 +1007,260 @@ namespace KiwiLight {
             farthestDistanceEvent;
     };
 
+    /**
+     * Decides which part of each frame a Runner searches. While a target is being tracked, only a padded
+     * window around its last bounds is searched, with a full-frame search after a miss or every few frames.
+     */
+    class RegionTracker {
+        public:
+        static const int DEFAULT_PADDING,
+                         DEFAULT_REFRESH_FRAMES;
+
+        RegionTracker();
+        RegionTracker(bool enabled, int padding, int refreshFrames);
+        RegionTracker(const RegionTracker &other);
+        RegionTracker &operator=(const RegionTracker &other);
+        cv::Rect NextRegion(cv::Size frameSize);
+        void Update(bool found, cv::Rect targetBounds);
+        bool Enabled() { return this->enabled; };
+        int Padding() { return this->padding; };
+        int RefreshFrames() { return this->refreshFrames; };
+        std::string Summary();
+
+        private:
+        mutable std::mutex trackerLock; //NextRegion() and Update() are called from different stages when pipelined
+
+        bool enabled,
+             locked;
+
+        int padding,       //percent of the target size to search past it on each side
+            refreshFrames, //window searches allowed before a full search
+            windowsInARow;
+
+        cv::Rect lastBounds;
+
+        long fullSearches,
+             windowSearches;
+    };
+
+    /**
+     * A constant-velocity Kalman filter for one measurement of a target, such as the x coordinate of its center.
+     * Positions are in pixels and time is in seconds. The filters of a target are kept apart because x, y, width 
+     * and height are measured and move independently, so each one only needs a 2x2 covariance.
+     */
+    struct TrackAxis {
+        void Reset(double position, double positionVariance, double velocityVariance);
+        void Predict(double seconds, double accelerationVariance);
+        void Correct(double measurement, double measurementVariance);
+        double At(double seconds) { return this->position + (this->velocity * seconds); };
+
+        double position,
+               velocity,
+               positionVariance,
+               covariance,
+               velocityVariance;
+    };
+
+    /**
+     * One target followed from frame to frame by a TargetTracker.
+     */
+    struct TargetTrack {
+        static const int AXES = 4; //center x, center y, width, height
+
+        int id,
+            hits,   //frames the target was seen in
+            misses; //frames in a row the target was not seen in
+        bool confirmed;
+        TrackAxis axes[AXES];
+        Target last; //the last target that was matched to the track
+    };
+
+    /**
+     * Follows targets between frames so that a Runner sends a smoothed, steady target instead of whatever 
+     * was closest in the last frame. Every track has a Kalman filter, and each new target goes to the track 
+     * that predicted it best. A track has to be seen a few frames in a row before it is sent, which keeps 
+     * out reflections that pass the filters for a frame or two, and keeps being predicted for a few frames 
+     * after it is lost, so one missed frame does not lose the target.
+     * The sent track does not change until it is lost.
+     */
+    class TargetTracker {
+        public:
+        static const int DEFAULT_CONFIRM_FRAMES,
+                         DEFAULT_COAST_FRAMES,
+                         MAX_TRACKS;
+
+        static const double MEASUREMENT_NOISE,
+                            ACCELERATION_NOISE,
+                            INITIAL_VELOCITY_NOISE,
+                            GATE,
+                            MAX_PREDICTION_SECONDS;
+
+        TargetTracker();
+        TargetTracker(bool enabled, int confirmFrames, int coastFrames);
+        void Update(long long timestamp, std::vector<Target> &targets, int preferred);
+        bool Estimate(long long timestamp, Target &estimate);
+        cv::Rect NextBounds();
+        bool Enabled() { return this->enabled; };
+        int ConfirmFrames() { return this->confirmFrames; };
+        int CoastFrames() { return this->coastFrames; };
+        std::string Summary();
+
+        private:
+        /**
+         * A track and a target that could be matched, and how far the target is from the track's prediction.
+         */
+        struct Pairing {
+            int track,
+                target;
+            double distance;
+
+            bool operator<(const Pairing &other) const { return this->distance < other.distance; };
+        };
+
+        static void MeasurementsOf(Target &target, double measurements[]);
+        static cv::Rect BoundsAt(TargetTrack &track, double seconds);
+        double Distance(TargetTrack &track, Target &target);
+        void Correct(TargetTrack &track, Target &target);
+        void StartTrack(Target &target);
+        int FindTrack(int id);
+        void Select(int preferredTrack);
+
+        bool enabled;
+        int confirmFrames,
+            coastFrames,
+            nextTrackId,
+            selectedTrack; //id of the track that is sent, or -1
+
+        long long lastTimestamp, //capture time of the last frame, in microseconds
+                  frameInterval; //time between the last two frames, in microseconds
+
+        std::vector<TargetTrack> tracks;
+        std::vector<Pairing> pairings;
+        std::vector<int> trackOfTarget; //id of the track each target of the last frame went to
+
+        long tracksStarted,
+             framesSent,
+             framesCoasted;
+    };
+
+    /**
+     * Everything the Runner knows about one frame as it moves through the stages of an iteration.
+     */
+    struct RunnerFrame {
+        long frameId; //id of the SharedFrame the image came from
+        long long timestamp; //when the image was captured, from Clock::GetMonotonicTime()
+        bool captured;
+        cv::Mat original,  //resized camera image
+                processed; //preprocessor output, covering only "region" of the original
+        cv::Rect region;   //part of the original that was searched
+        ContourTable contours;
+        std::vector<Target> targets;
+    };
+
+    /**
+     * One target as it is sent in a TargetPacket. Positions and sizes are in pixels, angles are in degrees.
+     */
+    struct PacketTarget {
+        int id,    //id of the ExampleTarget that the target was found with
+            flags; //TargetPacket::SENT, PREDICTED, and TRACKED
+
+        float x,
+              y,
+              width,
+              height,
+              distance,
+              horizontalAngle,
+              verticalAngle,
+              fit;
+    };
+
+    /**
+     * The binary message sent to the RIO in place of the text message. It has a fixed layout, so building and 
+     * reading one is a handful of stores and loads, and a sequence number so the robot can tell when packets are 
+     * lost or arrive out of order. Every number is big-endian, which is what Java's ByteBuffer reads by default.
+     * 
+     * Header (HEADER_SIZE bytes):
+     *   magic (2), version (1), header size (1), sequence (4), capture timestamp in microseconds (8),
+     *   capture-to-send latency in microseconds (4), number of targets (1), size of each target (1), reserved (2)
+     * Each target (TARGET_SIZE bytes):
+     *   id (2), flags (1), reserved (1), then x, y, width, height, distance, horizontal angle, vertical angle, 
+     *   and fit as 32-bit floats
+     * 
+     * Readers should use the sizes in the header to step through the packet, so that later versions can add 
+     * fields to the end of the header or of each target without breaking them.
+     */
+    class TargetPacket {
+        public:
+        static const int MAX_TARGETS = 8;
+        static const int MAGIC,
+                         VERSION,
+                         HEADER_SIZE,
+                         TARGET_SIZE;
+
+        //target flags
+        static const int SENT,      //the target that the text message would describe
+                         PREDICTED, //where the sent target is predicted to be when the packet is sent
+                         TRACKED;   //an estimate from the TargetTracker rather than a target seen in the frame
+
+        TargetPacket();
+        void Clear(uint32_t sequence, long long timestamp, long latency);
+        bool Add(PacketTarget target);
+        void Encode(std::string &bytes);
+        bool Decode(const char *bytes, int size);
+        uint32_t Sequence() { return this->sequence; };
+        long long Timestamp() { return this->timestamp; };
+        long Latency() { return this->latency; };
+        int NumberOfTargets() { return this->numberOfTargets; };
+        PacketTarget GetTarget(int index) { return this->targets[index]; };
+
+        private:
+        static void PutUnsigned(unsigned char *at, uint64_t value, int bytes);
+        static uint64_t GetUnsigned(const unsigned char *at, int bytes);
+        static void PutFloat(unsigned char *at, float value);
+        static float GetFloat(const unsigned char *at);
+
+        uint32_t sequence;
+        long long timestamp;
+        long latency;
+        int numberOfTargets;
+        PacketTarget targets[MAX_TARGETS];
+    };
+
+    /**
+     * Everything a Runner reuses from frame to frame, so that once the image size and number of contours settle, 
+     * Iterate() does not allocate. Copies of a Runner start with their own empty workspace.
+     */
+    struct RunnerWorkspace {
+        RunnerWorkspace() {};
+        RunnerWorkspace(const RunnerWorkspace &other) {};
+        RunnerWorkspace &operator=(const RunnerWorkspace &other) { return *this; };
+
+        RunnerFrame frame;   //the frame used by Iterate()
+        FrameArena arena;    //scratch memory for postprocessing, reset every frame
+        std::string message; //the message built by FinishFrame()
+        TargetPacket packet; //the binary version of the message, if the config uses it
+        std::string packetBytes;
+
+        //scratch for PreProcessPyramid()
+        cv::Mat coarse,
+                coarseMask,
+                windowMask;
+        std::vector< std::vector<cv::Point> > candidates;
+        std::vector<cv::Rect> windows;
+    };
+
     /**
      * Handles everything vision from taking images to send coordinates to a RoboRIO(or other UDP destination)
      */
     class Runner {
         public:
         static const std::string NULL_MESSAGE;
+        static const int MAX_PYRAMID_CANDIDATES;
+        static const int MAX_MESSAGE_SIZE = 256; //size of the stack buffer the text message is formatted into
+
+        static SharedFrame TakeFrame(long afterId);
+        static std::shared_ptr<FrameSource> GetFrameSource();
+        static void SetFrameSource(std::shared_ptr<FrameSource> source);
 
         Runner() {};
         Runner(std::string filename, bool debugging);
@@ -391,10 +1269,25 @@ namespace KiwiLight {
         PostProcessor GetPostProcessor() { return this->postprocessor; };
         int GetCameraIndex() { return this->cameraIndex; };
         void SetImageResize(Size sz);
-        std::string Iterate();
+        const std::string &Iterate();
+        const std::string &Iterate(SharedFrame source);
+        bool CaptureFrame(RunnerFrame &frame, SharedFrame source);
+        void PreProcessFrame(RunnerFrame &frame);
+        void PostProcessFrame(RunnerFrame &frame);
+        const std::string &FinishFrame(RunnerFrame &frame);
         bool GetLastFrameSuccessful() { return this->lastIterationSuccessful; };
+        long GetLastFrameId() { return this->lastFrameId; };
+        long long GetLastFrameAllocations() { return this->lastFrameAllocations; };
+        long long GetLastFrameTimestamp() { return this->lastFrameTimestamp; };
+        long long GetLastFrameLatency() { return this->lastFrameLatency; };
+        bool GetSendAge() { return this->sendAge; };
+        bool GetSendBinary() { return this->sendBinary; };
+        std::vector<UDPDestination> GetUDPDestinations() { return this->udpDestinations; };
+        const std::string &GetLastFramePacket();
         std::vector<Target> GetLastFrameTargets() { return this->lastFrameTargets; };
         Target GetClosestTargetToCenter() { return this->closestTarget; };
+        bool LastFrameFoundTarget() { return this->lastFrameFoundTarget; };
+        Target GetLastFrameSentTarget() { return (this->targetTracker.Enabled() ? this->trackedTarget : this->closestTarget); };
         Point GetLastFrameCenterPoint() { return this->lastFrameCenterPoint; };
         std::string GetFileName() { return this->src; };
         std::string GetConfName() { return this->configName; };
@@ -410,6 +1303,9 @@ namespace KiwiLight {
         SettingPair GetPostProcessorContourProperty(int contour, TargetProperty prop);
         void SetRunnerProperty(RunnerProperty prop, double value);
         double GetRunnerProperty(RunnerProperty prop);
+        RegionTracker GetRegionTracker() { return this->regionTracker; };
+        TargetTracker GetTargetTracker() { return this->targetTracker; };
+        int GetPyramidScale() { return this->pyramidScale; };
 
         //DEPRECATED:
         [[deprecated("This method will be removed in the next update.")]]
@@ -425,14 +1321,39 @@ namespace KiwiLight {
         int GetNumberOfContours(int target);
 
         private:
+        static std::shared_ptr<FrameSource> frameSource;
+        static std::mutex frameSourceLock;
+
         void parseDocument(XMLDocument doc);
+        ExampleTarget parseTarget(XMLTag targetTag);
         void applySettings(XMLDocument document);
+        void PreProcessPyramid(RunnerFrame &frame);
+        cv::Point RobotCenterFor(Target &target);
+        void AppendTarget(MessageWriter &message, Target &target, bool found);
+        void BuildPacket(RunnerFrame &frame, Target &sentTarget, bool found, bool predicted, int sentIndex);
+        void BuildEmptyPacket();
+        PacketTarget MakePacketTarget(Target &target, int flags);
 
         PreProcessor preprocessor;
         PostProcessor postprocessor;
         Size constantResize;
-
-        Target closestTarget;
+        RegionTracker regionTracker;
+        TargetTracker targetTracker;
+        RunnerWorkspace workspace;
+        long long lastFrameAllocations; //heap allocations made by the last Iterate(), if AllocationCounter is enabled
+        long long lastFrameTimestamp,   //when the last frame was captured, from Clock::GetMonotonicTime()
+                  lastFrameLatency;     //microseconds from the capture of the last frame to its message being built
+        bool sendAge, //true to add the age of the frame, in milliseconds, to the end of each message
+             sendBinary, //true to send a TargetPacket instead of the text message
+             lastFrameCaptured, //true if the last frame given to FinishFrame() had an image
+             lastFrameFoundTarget; //true if the message of the last frame describes a target, seen or tracked
+        uint32_t packetSequence; //sequence number of the next TargetPacket
+        std::vector<UDPDestination> udpDestinations; //where messages go besides the <UDP> address and port
+        int pyramidScale; //how many times smaller the image used to find candidates is. 1 to not use a pyramid
+
+        Target closestTarget,
+               trackedTarget,   //the tracked target at the time its frame was captured
+               predictedTarget; //the tracked target at the time its message is sent
 
         std::string src,
                     configName;
@@ -446,6 +1367,7 @@ namespace KiwiLight {
         std::vector<Target> lastFrameTargets;
         Point lastFrameCenterPoint;
         bool lastIterationSuccessful;
+        long lastFrameId;
         bool stop,
              debug;
 
@@ -453,6 +1375,106 @@ namespace KiwiLight {
                centerOffsetY;
     };
 
+    /**
+     * Runs a Runner's stages (capture, preprocessing, contour and target extraction, and output) on separate threads 
+     * connected by bounded queues, so that consecutive frames are worked on at the same time.
+     * The output stage runs on whichever thread calls Next().
+     */
+    class RunnerPipeline {
+        public:
+        static const int DEFAULT_QUEUE_DEPTH;
+
+        RunnerPipeline(Runner *runner, int queueDepth);
+        ~RunnerPipeline();
+        void Start();
+        void Stop();
+        const std::string &Next();
+        bool Drained() { return this->drained.load(); };
+        std::string Summary();
+
+        private:
+        /**
+         * Running timing and occupancy totals for one stage.
+         */
+        struct StageStats {
+            StageStats() : frames(0), totalMicros(0), maxMicros(0), totalQueued(0) {};
+            std::atomic<long> 
+                frames,
+                totalMicros,
+                maxMicros,
+                totalQueued; //sum of the stage's input queue size, sampled once per frame
+        };
+
+        enum Stage {
+            CAPTURE,
+            PREPROCESS,
+            POSTPROCESS,
+            OUTPUT,
+            NUMBER_OF_STAGES
+        };
+
+        void CaptureLoop();
+        void PreProcessLoop();
+        void PostProcessLoop();
+        void RecordStage(Stage stage, std::chrono::steady_clock::time_point start, int queued);
+
+        Runner *runner;
+        int queueDepth;
+        std::atomic<bool> 
+            running,
+            drained; //true once the frame source ran out and every frame has come out of the pipeline
+
+        SPSCQueue<RunnerFrame> 
+            capturedFrames,
+            preprocessedFrames,
+            postprocessedFrames;
+
+        std::thread 
+            captureThread,
+            preprocessThread,
+            postprocessThread;
+
+        StageStats stats[NUMBER_OF_STAGES];
+        StageStats latency; //time from capture to the message being built, for frames with an image
+    };
+
+    /**
+     * Runs several Runners on the same frame at once, each on its own worker from a fixed thread pool.
+     * Iterate() returns once every Runner has finished the frame.
+     */
+    class ConfigExecutor {
+        public:
+        ConfigExecutor(Runner *runners, int numRunners);
+        const std::vector<std::string> &Iterate();
+        long LastFrameId() { return this->lastFrameId; };
+        std::string Summary();
+
+        private:
+        /**
+         * Running timing totals for one config. Only written by the worker running the config.
+         */
+        struct ConfigStats {
+            ConfigStats() : frames(0), totalMicros(0), maxMicros(0), capturedFrames(0), totalLatencyMicros(0), maxLatencyMicros(0), lastAllocations(0) {};
+            long 
+                frames,
+                totalMicros,
+                maxMicros,
+                capturedFrames,     //frames that had an image
+                totalLatencyMicros, //time from capture to the message being built, for frames that had an image
+                maxLatencyMicros;
+            long long lastAllocations; //heap allocations made by the last frame, when counting is compiled in
+        };
+
+        void RunConfig(int index, SharedFrame frame);
+
+        Runner *runners;
+        long lastFrameId;
+        std::vector<std::string> results;
+        std::vector<ConfigStats> stats;
+        ConfigStats frameStats;
+        std::unique_ptr<ThreadPool> pool;
+    };
+
     /**
      * utility that learns a seen target
      */
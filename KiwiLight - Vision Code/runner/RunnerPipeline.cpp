@@ -0,0 +1,221 @@
+#include "Runner.h"
+
+/**
+ * Source file for the RunnerPipeline class.
+ * Written By: Brach Knutson
+ */
+
+using namespace cv;
+using namespace KiwiLight;
+
+const int RunnerPipeline::DEFAULT_QUEUE_DEPTH = 1;
+
+/**
+ * Creates a new RunnerPipeline which runs the stages of "runner." The runner must outlive the pipeline.
+ * @param runner The Runner whose stages should be run.
+ * @param queueDepth The number of frames that can wait between two stages. More depth smooths out 
+ * uneven stage times, but each waiting frame adds latency.
+ */
+RunnerPipeline::RunnerPipeline(Runner *runner, int queueDepth)
+ : capturedFrames(queueDepth),
+   preprocessedFrames(queueDepth),
+   postprocessedFrames(queueDepth) {
+    this->runner = runner;
+    this->queueDepth = queueDepth;
+    this->running.store(false);
+    this->drained.store(false);
+}
+
+/**
+ * Stops the pipeline if it is still running.
+ */
+RunnerPipeline::~RunnerPipeline() {
+    Stop();
+}
+
+/**
+ * Starts the capture, preprocessing, and postprocessing threads.
+ */
+void RunnerPipeline::Start() {
+    if(this->running.load()) {
+        return;
+    }
+
+    this->running.store(true);
+    this->captureThread     = std::thread(&RunnerPipeline::CaptureLoop, this);
+    this->preprocessThread  = std::thread(&RunnerPipeline::PreProcessLoop, this);
+    this->postprocessThread = std::thread(&RunnerPipeline::PostProcessLoop, this);
+}
+
+/**
+ * Stops all stage threads and waits for them to finish.
+ */
+void RunnerPipeline::Stop() {
+    this->running.store(false);
+    this->capturedFrames.Close();
+    this->preprocessedFrames.Close();
+    this->postprocessedFrames.Close();
+
+    if(this->captureThread.joinable()) {
+        this->captureThread.join();
+    }
+
+    if(this->preprocessThread.joinable()) {
+        this->preprocessThread.join();
+    }
+
+    if(this->postprocessThread.joinable()) {
+        this->postprocessThread.join();
+    }
+}
+
+/**
+ * Runs the output stage on the next frame to come out of the pipeline.
+ * Blocks until a frame is available.
+ * @return The message that should be sent to the RIO, or Runner::NULL_MESSAGE if the pipeline is stopped 
+ * or has run out of frames, after which Drained() is true.
+ * It is only valid until the next call.
+ */
+const std::string &RunnerPipeline::Next() {
+    RunnerFrame frame;
+    int queued = this->postprocessedFrames.Size();
+    if(!this->postprocessedFrames.Pop(frame)) {
+        this->drained.store(true);
+        return Runner::NULL_MESSAGE;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const std::string &message = this->runner->FinishFrame(frame);
+    RecordStage(Stage::OUTPUT, start, queued);
+
+    if(frame.captured) {
+        long latencyMicros = this->runner->GetLastFrameLatency();
+        this->latency.frames++;
+        this->latency.totalMicros += latencyMicros;
+        this->latency.maxMicros.store(std::max(this->latency.maxMicros.load(), latencyMicros));
+    }
+    return message;
+}
+
+/**
+ * Returns a summary of the average time spent in each stage and the average number of frames waiting in front of it.
+ */
+std::string RunnerPipeline::Summary() {
+    const std::string stageNames[NUMBER_OF_STAGES] = { "capture", "preprocess", "postprocess", "output" };
+
+    std::string summary = "";
+    for(int i=0; i<NUMBER_OF_STAGES; i++) {
+        long frames = this->stats[i].frames.load();
+        double averageMillis = (frames > 0 ? this->stats[i].totalMicros.load() / (double) frames / 1000.0 : 0);
+        double maxMillis = this->stats[i].maxMicros.load() / 1000.0;
+        double averageQueued = (frames > 0 ? this->stats[i].totalQueued.load() / (double) frames : 0);
+
+        summary += stageNames[i] + ": " + std::to_string(averageMillis) + "ms avg, " + std::to_string(maxMillis) + "ms max";
+        if(i > Stage::CAPTURE) {
+            summary += ", queue " + std::to_string(averageQueued) + "/" + std::to_string(this->queueDepth);
+        }
+
+        summary += "\n";
+    }
+
+    long latencyFrames = this->latency.frames.load();
+    double averageLatencyMillis = (latencyFrames > 0 ? this->latency.totalMicros.load() / (double) latencyFrames / 1000.0 : 0);
+    double maxLatencyMillis = this->latency.maxMicros.load() / 1000.0;
+    summary += "capture to send: " + std::to_string(averageLatencyMillis) + "ms avg, " + std::to_string(maxLatencyMillis) + "ms max";
+    return summary;
+}
+
+/**
+ * Takes frames and hands them to the preprocessing stage until stopped or the frame source runs out.
+ * Frames without an image are passed along too, so the output stage still reports them.
+ */
+void RunnerPipeline::CaptureLoop() {
+    long lastFrameId = -1;
+    while(this->running.load()) {
+        RunnerFrame frame;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        SharedFrame source = Runner::TakeFrame(lastFrameId);
+        if(!source.Valid() && Runner::GetFrameSource()->Finished()) {
+            break;
+        }
+
+        this->runner->CaptureFrame(frame, source);
+        lastFrameId = frame.frameId;
+        RecordStage(Stage::CAPTURE, start, 0);
+
+        if(!this->capturedFrames.Push(std::move(frame))) {
+            break;
+        }
+    }
+
+    //the later stages finish the frames they already have, then close their own queues
+    this->capturedFrames.Close();
+}
+
+/**
+ * Preprocesses captured frames until stopped.
+ */
+void RunnerPipeline::PreProcessLoop() {
+    RunnerFrame frame;
+    while(this->running.load()) {
+        int queued = this->capturedFrames.Size();
+        if(!this->capturedFrames.Pop(frame)) {
+            break;
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if(frame.captured) {
+            this->runner->PreProcessFrame(frame);
+        }
+        RecordStage(Stage::PREPROCESS, start, queued);
+
+        if(!this->preprocessedFrames.Push(std::move(frame))) {
+            break;
+        }
+    }
+
+    this->preprocessedFrames.Close();
+}
+
+/**
+ * Finds contours and targets in preprocessed frames until stopped.
+ */
+void RunnerPipeline::PostProcessLoop() {
+    RunnerFrame frame;
+    while(this->running.load()) {
+        int queued = this->preprocessedFrames.Size();
+        if(!this->preprocessedFrames.Pop(frame)) {
+            break;
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if(frame.captured) {
+            this->runner->PostProcessFrame(frame);
+        }
+        RecordStage(Stage::POSTPROCESS, start, queued);
+
+        if(!this->postprocessedFrames.Push(std::move(frame))) {
+            break;
+        }
+    }
+
+    this->postprocessedFrames.Close();
+}
+
+/**
+ * Adds one frame's timing and queue occupancy to the totals of "stage."
+ * @param stage The stage that just finished a frame.
+ * @param start The time the stage started working on the frame.
+ * @param queued The number of frames that were waiting in front of the stage when it took the frame.
+ */
+void RunnerPipeline::RecordStage(Stage stage, std::chrono::steady_clock::time_point start, int queued) {
+    long micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    StageStats &stageStats = this->stats[stage];
+    stageStats.frames++;
+    stageStats.totalMicros += micros;
+    stageStats.totalQueued += queued;
+
+    if(micros > stageStats.maxMicros.load()) {
+        stageStats.maxMicros.store(micros);
+    }
+}
@@ -0,0 +1,36 @@
+#include "Runner.h"
+
+/**
+ * Source file for the SharedFramePool class.
+ * Written By: Brach Knutson
+ */
+
+using namespace cv;
+using namespace KiwiLight;
+
+/**
+ * Copies "image" into a buffer that no SharedFrame points to anymore, or into a new buffer if they are all in use.
+ * Only one thread may call this at a time.
+ * @param id The id of the new frame.
+ * @param image The image to copy.
+ * @param timestamp When the image was captured, from Clock::GetMonotonicTime().
+ * @return A SharedFrame with its own copy of "image".
+ */
+SharedFrame SharedFramePool::Copy(long id, const cv::Mat &image, long long timestamp) {
+    //a buffer only the pool still points to is free, and only this thread can hand it out again
+    std::shared_ptr<cv::Mat> buffer;
+    for(int i=0; i<this->buffers.size(); i++) {
+        if(this->buffers[i].use_count() == 1) {
+            buffer = this->buffers[i];
+            break;
+        }
+    }
+
+    if(!buffer) {
+        buffer = std::make_shared<cv::Mat>();
+        this->buffers.push_back(buffer);
+    }
+
+    image.copyTo(*buffer);
+    return SharedFrame(id, std::shared_ptr<const cv::Mat>(buffer), timestamp);
+}
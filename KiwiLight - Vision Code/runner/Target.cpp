@@ -21,6 +21,7 @@ Target::Target() {
     this->focalHeight = -1;
     this->distErrorCorrect = -1;
     this->calibratedDistance = -1;
+    this->fit = 0;
     this->width = -1;
     this->height = -1;
     this->x = -1;
@@ -33,52 +34,94 @@ Target::Target() {
  * Targets will be generated by the ExampleTarget class. Use an
  * ExampleTarget object to find targets!!!
  */
-Target::Target(int id, std::vector<Contour> contours, double knownHeight, double focalHeight, double distErrorCorrect, double calibratedDistance, DistanceCalcMode distMode) {
+Target::Target(int id, const std::vector<Contour> &contours, double knownHeight, double focalHeight, double distErrorCorrect, double calibratedDistance, DistanceCalcMode distMode) {
+    this->Set(id, contours.data(), contours.size(), knownHeight, focalHeight, distErrorCorrect, calibratedDistance, distMode);
+}
+
+/**
+ * Returns the bounding box of a group of contours, measured the same way a Target made from them would be.
+ * @param contours The first contour of the group.
+ * @param count The number of contours in the group.
+ */
+cv::Rect Target::BoundsOf(const Contour *contours, int count) {
+    int biggestX = -5000;
+    int smallestX = 5000;
+    int biggestY = -5000;
+    int smallestY = 5000;
+
+    int biggestXWidth = 0;
+    int biggestYHeight = 0; 
+
+    for(int i=0; i<count; i++) {
+        Contour contour = contours[i];
+        if(contour.X() > biggestX) {
+            biggestX = contour.X();
+            biggestXWidth = contour.Width();
+        } 
+        if(contour.X() < smallestX) {
+            smallestX = contour.X();
+        }
+
+        if(contour.Y() > biggestY) {
+            biggestY = contour.Y();
+            biggestYHeight = contour.Height();
+        }
+        if(contour.Y() < smallestY) {
+            smallestY = contour.Y();
+        }
+    }
+
+    int width = (biggestX - smallestX) + biggestXWidth;
+    int height = (biggestY - smallestY) + biggestYHeight;
+    return cv::Rect(smallestX, smallestY, width, height);
+}
+
+/**
+ * Makes this Target represent a new group of contours. Reuses this Target's memory where it can,
+ * so that Targets in a vector that is kept between frames do not have to allocate.
+ * @param id The id of the target.
+ * @param contours The first contour of the target.
+ * @param count The number of contours in the target.
+ */
+void Target::Set(int id, const Contour *contours, int count, double knownHeight, double focalHeight, double distErrorCorrect, double calibratedDistance, DistanceCalcMode distMode) {
+    this->contours.assign(contours, contours + count);
+    this->Measure(id, knownHeight, focalHeight, distErrorCorrect, calibratedDistance, distMode);
+}
+
+/**
+ * Makes this Target represent a group of rows from a ContourTable. Reuses this Target's memory where it can.
+ * @param id The id of the target.
+ * @param table The table holding the contours.
+ * @param rows The rows of the contours in the table.
+ * @param count The number of contours in the target.
+ */
+void Target::Set(int id, ContourTable &table, const int *rows, int count, double knownHeight, double focalHeight, double distErrorCorrect, double calibratedDistance, DistanceCalcMode distMode) {
+    this->contours.clear();
+    for(int i=0; i<count; i++) {
+        this->contours.push_back(table.Get(rows[i]));
+    }
+
+    this->Measure(id, knownHeight, focalHeight, distErrorCorrect, calibratedDistance, distMode);
+}
+
+/**
+ * Stores the target's settings and finds its center and size from this->contours.
+ * The fit is cleared; the ExampleTarget that found the target sets it with SetFit().
+ */
+void Target::Measure(int id, double knownHeight, double focalHeight, double distErrorCorrect, double calibratedDistance, DistanceCalcMode distMode) {
     this->id = id;
-    this->contours = contours;
     this->knownHeight = knownHeight;
     this->focalHeight = focalHeight;
     this->distErrorCorrect = distErrorCorrect;
     this->calibratedDistance = calibratedDistance;
     this->distMode = distMode;
+    this->fit = 0;
 
-    if(contours.size() == 1) {
-        this->width = contours[0].Width();
-        this->height = contours[0].Height();
-        this->x = (this->width / 2) + contours[0].X();
-        this->y = (this->height / 2) + contours[0].Y();
-    } else {
-        int biggestX = -5000;
-        int smallestX = 5000;
-        int biggestY = -5000;
-        int smallestY = 5000;
-
-        int biggestXWidth = 0;
-        int biggestYHeight = 0; 
-
-        for(int i=0; i<contours.size(); i++) {
-            if(contours[i].X() > biggestX) {
-                biggestX = contours[i].X();
-                biggestXWidth = contours[i].Width();
-            } 
-             if(contours[i].X() < smallestX) {
-                smallestX = contours[i].X();
-            }
-
-            if(contours[i].Y() > biggestY) {
-                biggestY = contours[i].Y();
-                biggestYHeight = contours[i].Height();
-            }
-             if(contours[i].Y() < smallestY) {
-                smallestY = contours[i].Y();
-            }
-        }
-
-        this->width = (biggestX - smallestX) + biggestXWidth;
-        this->height = (biggestY - smallestY) + biggestYHeight;
-        this->x = (this->width / 2) + smallestX;
-        this->y = (this->height / 2) + smallestY;
-    }
+    cv::Rect bounds = BoundsOf(this->contours.data(), this->contours.size());
+    this->width = bounds.width;
+    this->height = bounds.height;
+    this->x = (this->width / 2) + bounds.x;
+    this->y = (this->height / 2) + bounds.y;
 }
 
 /**
@@ -109,6 +152,16 @@ double Target::Distance(DistanceCalcMode mode) {
  * @param imageCenterX The x coordinate of the center of the image. (width / 2)
  */
 int Target::HorizontalAngle(double distanceToTarget, int imageCenterX) {
+    return (int) this->HorizontalAngleDegrees(distanceToTarget, imageCenterX);
+}
+
+/**
+ * Returns the angle (in degrees) the robot needs to turn horizontally to be considered "aligned" with the target, 
+ * without rounding it to a whole degree.
+ * @param distanceToTarget The Distance to the target.
+ * @param imageCenterX The x coordinate of the center of the image. (width / 2)
+ */
+double Target::HorizontalAngleDegrees(double distanceToTarget, int imageCenterX) {
     double inchesPerPixel = this->knownHeight / this->Bounds().width;
     int pixelsToTarget = imageCenterX - this->Center().x;
 
@@ -116,8 +169,7 @@ int Target::HorizontalAngle(double distanceToTarget, int imageCenterX) {
     double angle = atan(inchesToTarget / distanceToTarget);
 
     //convert to degrees
-    angle *= (180 / M_PI);
-    return (int) angle;
+    return angle * (180 / M_PI);
 }
 
 /**
@@ -134,6 +186,16 @@ int Target::HorizontalAngle(int imageCenterX) {
  * @param imageCenterY the Y coordinate of the center of the image.
  */
 int Target::VerticalAngle(double distanceToTarget, int imageCenterY) {
+    return (int) this->VerticalAngleDegrees(distanceToTarget, imageCenterY);
+}
+
+/**
+ * Returns the angle (in degrees) the robot needs to turn vertically to be considered "aligned" with the target, 
+ * without rounding it to a whole degree.
+ * @param distanceToTarget the distance to the target.
+ * @param imageCenterY the Y coordinate of the center of the image.
+ */
+double Target::VerticalAngleDegrees(double distanceToTarget, int imageCenterY) {
     double InchesPerPixel = this->knownHeight / this->Bounds().width;
     int pixelsToTarget = imageCenterY - this->Center().y;
     
@@ -141,8 +203,7 @@ int Target::VerticalAngle(double distanceToTarget, int imageCenterY) {
     double angle = atan(inchesToTarget / distanceToTarget);
 
     //convert to degrees and return
-    angle *= (180 / M_PI);
-    return (int) angle;
+    return angle * (180 / M_PI);
 }
 
 /**
@@ -186,4 +247,15 @@ cv::Rect Target::Bounds() {
     int trueY = this->y - (this->height / 2);
 
     return cv::Rect(trueX, trueY, this->width, this->height);
-}
\ No newline at end of file
+}
+
+/**
+ * Moves and resizes the target without changing its contours. Distance and angles are measured from the new bounds.
+ * Used for targets estimated by a TargetTracker rather than seen in a frame.
+ */
+void Target::SetBounds(cv::Rect bounds) {
+    this->width = bounds.width;
+    this->height = bounds.height;
+    this->x = (this->width / 2) + bounds.x;
+    this->y = (this->height / 2) + bounds.y;
+}
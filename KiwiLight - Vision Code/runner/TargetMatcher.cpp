@@ -0,0 +1,648 @@
+#include "Runner.h"
+
+/**
+ * Source file for the TargetMatcher class.
+ * Written By: Brach Knutson
+ */
+
+using namespace cv;
+using namespace KiwiLight;
+
+const int TargetMatcher::MAX_EXPANSIONS = 50000;
+const int TargetMatcher::MAX_GRID_SIDE = 32;
+const double TargetMatcher::WIDTH_SLACK = 1e-9;
+const int TargetMatcher::MAX_ASSIGNED_ROLES = 12;
+const int TargetMatcher::MAX_FIXED_ROLES = 3;
+
+/**
+ * Returns an array of "count" values taken from "arena".
+ */
+template<typename T>
+static T *AllocateArray(FrameArena &arena, int count) {
+    return (T*) arena.Allocate(std::max(count, 1) * sizeof(T), alignof(T));
+}
+
+/**
+ * Returns how far "value" is from the middle of the range (lower, upper), from 0 in the middle to 1 at either end.
+ */
+static double Deviation(double value, double lower, double upper) {
+    double middle = (lower + upper) / 2;
+    double halfRange = (upper - lower) / 2;
+    if(halfRange <= 0) {
+        return 1;
+    }
+
+    return std::min(1.0, std::fabs(value - middle) / halfRange);
+}
+
+/**
+ * Narrows the range of possible target widths so that (difference / width) lies between lower and upper.
+ * Returns false if no width can do that.
+ * @param difference The distance between the centers of two contours.
+ * @param lower The smallest allowed ratio, the lower DistX (or DistY) bound of the first contour's role minus the upper bound of the second's.
+ * @param upper The largest allowed ratio.
+ * @param widthLower The smallest possible target width. Raised if needed.
+ * @param widthUpper The largest possible target width. Lowered if needed.
+ */
+static bool NarrowWidth(double difference, double lower, double upper, double &widthLower, double &widthUpper) {
+    //difference > lower * width
+    if(lower > 0) {
+        if(difference <= 0) {
+            return false;
+        }
+        widthUpper = std::min(widthUpper, difference / lower);
+    } else if(lower < 0) {
+        widthLower = std::max(widthLower, difference / lower);
+    } else if(difference < 0) {
+        return false;
+    }
+
+    //difference < upper * width
+    if(upper > 0) {
+        widthLower = std::max(widthLower, difference / upper);
+    } else if(upper < 0) {
+        if(difference >= 0) {
+            return false;
+        }
+        widthUpper = std::min(widthUpper, difference / upper);
+    } else if(difference > 0) {
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Creates a new TargetMatcher. Everything it needs is taken from "arena", which must not be reset while the matcher is used.
+ * @param roles The ExampleContours of the target. Each contour in a group gets the role of one of them.
+ * @param table The contours to search.
+ * @param accepted The results of ExampleContour::TestContours(). accepted[(role * table.Size()) + row] is nonzero if the role accepts the row.
+ * @param validRows The rows that at least one role accepts.
+ * @param numberOfValidRows The number of rows in "validRows".
+ * @param arena Where to keep the grid and the search state.
+ */
+TargetMatcher::TargetMatcher(std::vector<ExampleContour> &roles, ContourTable &table, const unsigned char *accepted, const int *validRows, int numberOfValidRows, FrameArena &arena) {
+    this->arena = &arena;
+    this->table = &table;
+    this->accepted = accepted;
+    this->validRows = validRows;
+    this->numberOfValidRows = numberOfValidRows;
+    this->numberOfRoles = roles.size();
+    this->numberOfRows = table.Size();
+    this->groups = 0;
+    this->fits = 0;
+    this->groupsFound = 0;
+    this->expansions = 0;
+    this->capped = false;
+
+    int numberOfRoles = this->numberOfRoles;
+    this->lowerX = AllocateArray<double>(arena, numberOfRoles);
+    this->upperX = AllocateArray<double>(arena, numberOfRoles);
+    this->lowerY = AllocateArray<double>(arena, numberOfRoles);
+    this->upperY = AllocateArray<double>(arena, numberOfRoles);
+    this->order = AllocateArray<int>(arena, numberOfRoles);
+    this->chosen = AllocateArray<int>(arena, numberOfRoles);
+    this->widthLower = AllocateArray<double>(arena, numberOfRoles + 1);
+    this->widthUpper = AllocateArray<double>(arena, numberOfRoles + 1);
+    this->leftMin = AllocateArray<int>(arena, numberOfRoles + 1);
+    this->leftMax = AllocateArray<int>(arena, numberOfRoles + 1);
+    this->sortedRows = AllocateArray<int>(arena, numberOfRoles);
+    this->scores = AllocateArray<double>(arena, numberOfRoles * numberOfRoles);
+    this->assigned = AllocateArray<int>(arena, numberOfRoles);
+
+    //the best total fit of every set of group members given to the first roles, and the member given to the last of those roles
+    int assignmentStates = (numberOfRoles <= MAX_ASSIGNED_ROLES ? 1 << numberOfRoles : 0);
+    this->bestTotals = AllocateArray<double>(arena, assignmentStates);
+    this->lastMembers = AllocateArray<int>(arena, assignmentStates);
+
+    int *candidates = AllocateArray<int>(arena, numberOfRoles);
+    for(int r=0; r<numberOfRoles; r++) {
+        this->lowerX[r] = roles[r].DistX().LowerBound();
+        this->upperX[r] = roles[r].DistX().UpperBound();
+        this->lowerY[r] = roles[r].DistY().LowerBound();
+        this->upperY[r] = roles[r].DistY().UpperBound();
+
+        candidates[r] = 0;
+        for(int i=0; i<numberOfValidRows; i++) {
+            candidates[r] += (accepted[(r * this->numberOfRows) + validRows[i]] != 0);
+        }
+
+        //fill the roles with the fewest candidates first so that the search stays narrow
+        int place = r;
+        while(place > 0 && candidates[this->order[place - 1]] > candidates[r]) {
+            this->order[place] = this->order[place - 1];
+            place--;
+        }
+        this->order[place] = r;
+    }
+
+    //centers of every contour, measured the same way that ScoreGroup() measures them
+    this->centerX = AllocateArray<int>(arena, this->numberOfRows);
+    this->centerY = AllocateArray<int>(arena, this->numberOfRows);
+    this->used = AllocateArray<unsigned char>(arena, this->numberOfRows);
+    for(int row=0; row<this->numberOfRows; row++) {
+        this->centerX[row] = (table.width[row] / 2) + table.x[row];
+        this->centerY[row] = (table.height[row] / 2) + table.y[row];
+        this->used[row] = 0;
+    }
+
+    //how far each valid contour's angle, aspect ratio, and solidity are from what each role wants
+    this->shapeDeviations = AllocateArray<double>(arena, numberOfRoles * this->numberOfRows);
+    for(int r=0; r<numberOfRoles; r++) {
+        SettingPair 
+            angle = roles[r].Angle(),
+            aspectRatio = roles[r].AspectRatio(),
+            solidity = roles[r].Solidity();
+
+        double *deviations = this->shapeDeviations + (r * this->numberOfRows);
+        for(int i=0; i<numberOfValidRows; i++) {
+            int row = validRows[i];
+            deviations[row] = 
+                Deviation(table.angle[row], angle.LowerBound(), angle.UpperBound()) +
+                Deviation(table.aspectRatio[row], aspectRatio.LowerBound(), aspectRatio.UpperBound()) +
+                Deviation(table.solidity[row], solidity.LowerBound(), solidity.UpperBound());
+        }
+    }
+
+    //no group of valid contours can be wider than all of them together
+    int smallestLeft = INT_MAX,
+        biggestLeft = INT_MIN,
+        biggestWidth = 0,
+        smallestCenterX = INT_MAX,
+        biggestCenterX = INT_MIN,
+        smallestCenterY = INT_MAX,
+        biggestCenterY = INT_MIN;
+
+    for(int i=0; i<numberOfValidRows; i++) {
+        int row = validRows[i];
+        smallestLeft = std::min(smallestLeft, table.x[row]);
+        biggestLeft = std::max(biggestLeft, table.x[row]);
+        biggestWidth = std::max(biggestWidth, table.width[row]);
+        smallestCenterX = std::min(smallestCenterX, this->centerX[row]);
+        biggestCenterX = std::max(biggestCenterX, this->centerX[row]);
+        smallestCenterY = std::min(smallestCenterY, this->centerY[row]);
+        biggestCenterY = std::max(biggestCenterY, this->centerY[row]);
+    }
+
+    this->greatestWidth = (numberOfValidRows > 0 ? (biggestLeft - smallestLeft) + biggestWidth : 0);
+
+    //bucket the valid contours by center into a grid with about one contour per cell
+    int side = (int) std::ceil(std::sqrt((double) numberOfValidRows));
+    side = std::max(1, std::min(side, MAX_GRID_SIDE));
+    this->gridColumns = side;
+    this->gridRows = side;
+    this->gridX = (numberOfValidRows > 0 ? smallestCenterX : 0);
+    this->gridY = (numberOfValidRows > 0 ? smallestCenterY : 0);
+    this->cellWidth = (numberOfValidRows > 0 ? (biggestCenterX - smallestCenterX) / side + 1 : 1);
+    this->cellHeight = (numberOfValidRows > 0 ? (biggestCenterY - smallestCenterY) / side + 1 : 1);
+
+    int numberOfCells = this->gridColumns * this->gridRows;
+    this->cellStart = AllocateArray<int>(arena, numberOfCells + 1);
+    this->cellRows = AllocateArray<int>(arena, numberOfValidRows);
+    int *cellFill = AllocateArray<int>(arena, numberOfCells);
+    for(int c=0; c<=numberOfCells; c++) {
+        this->cellStart[c] = 0;
+    }
+
+    for(int i=0; i<numberOfValidRows; i++) {
+        int row = validRows[i];
+        this->cellStart[CellOf(this->centerX[row], this->centerY[row]) + 1]++;
+    }
+
+    for(int c=0; c<numberOfCells; c++) {
+        this->cellStart[c + 1] += this->cellStart[c];
+        cellFill[c] = this->cellStart[c];
+    }
+
+    for(int i=0; i<numberOfValidRows; i++) {
+        int row = validRows[i];
+        int cell = CellOf(this->centerX[row], this->centerY[row]);
+        this->cellRows[cellFill[cell]] = row;
+        cellFill[cell]++;
+    }
+}
+
+/**
+ * Returns the FindBestGroups() to use for targets with "numberOfRoles" contours. Targets with up to 
+ * MAX_FIXED_ROLES contours get a version built for exactly that many, with fixed size arrays and loops 
+ * the compiler can unroll. Bigger targets get the version that works for any number.
+ */
+TargetMatcher::BestGroupsMethod TargetMatcher::BestGroupsFor(int numberOfRoles) {
+    switch(numberOfRoles) {
+        case 1:
+            return &TargetMatcher::FindBestGroups<1>;
+        case 2:
+            return &TargetMatcher::FindBestGroups<2>;
+        case 3:
+            return &TargetMatcher::FindBestGroups<3>;
+        default:
+            return &TargetMatcher::FindBestGroups<0>;
+    }
+}
+
+/**
+ * Finds every group of contours that fits the target, and appends the rows of each group to "groups".
+ * Each group takes up one entry per role, in the role that fits it best. Its fit, from 0 (barely passing) 
+ * to 1 (exactly as configured), is appended to "fits". A group is only reported once, even if its contours 
+ * fit the roles in more than one way.
+ * The search stops early, keeping the groups found so far, once MAX_EXPANSIONS contours have been tried; see Capped().
+ * @return The number of groups found.
+ */
+template<int ROLES>
+int TargetMatcher::FindGroups(ArenaVector<int> &groups, ArenaVector<double> &fits) {
+    const int numberOfRoles = RoleCount<ROLES>();
+    this->groups = &groups;
+    this->fits = &fits;
+    this->groupsFound = 0;
+    this->expansions = 0;
+    this->capped = false;
+
+    if(numberOfRoles == 0) {
+        return 0;
+    }
+
+    this->widthLower[0] = 0;
+    this->widthUpper[0] = this->greatestWidth;
+    int firstRole = this->order[0];
+    for(int i=0; i<this->numberOfValidRows; i++) {
+        int row = this->validRows[i];
+        if(!this->accepted[(firstRole * this->numberOfRows) + row]) {
+            continue;
+        }
+
+        if(!Expand()) {
+            break;
+        }
+
+        Place<ROLES>(0, row);
+    }
+
+    return this->groupsFound;
+}
+
+/**
+ * Finds the groups of contours that fit the target best, without letting two groups share a contour.
+ * Groups are taken in order of fit, best first, and skipped if they share a contour with a group already taken.
+ * @param groups Where to append the rows of each group taken, one entry per role.
+ * @param fits Where to append the fit of each group taken.
+ * @param maxGroups The most groups to take.
+ * @return The number of groups taken.
+ */
+template<int ROLES>
+int TargetMatcher::FindBestGroups(ArenaVector<int> &groups, ArenaVector<double> &fits, int maxGroups) {
+    const int numberOfRoles = RoleCount<ROLES>();
+    ArenaVector<int> allGroups = ArenaVector<int>(ArenaAllocator<int>(this->arena));
+    ArenaVector<double> allFits = ArenaVector<double>(ArenaAllocator<double>(this->arena));
+    int numberFound = FindGroups<ROLES>(allGroups, allFits);
+
+    ArenaVector<int> ranking = ArenaVector<int>(ArenaAllocator<int>(this->arena));
+    for(int g=0; g<numberFound; g++) {
+        ranking.push_back(g);
+    }
+
+    std::stable_sort(ranking.begin(), ranking.end(), [&allFits](int a, int b) { return allFits[a] > allFits[b]; });
+
+    //this->used is all zeros again once the search is done, so it can mark the contours that are taken
+    int numberTaken = 0;
+    for(int i=0; i<numberFound && numberTaken < maxGroups; i++) {
+        const int *group = allGroups.data() + (ranking[i] * numberOfRoles);
+        bool overlaps = false;
+        for(int r=0; r<numberOfRoles; r++) {
+            overlaps = overlaps || this->used[group[r]];
+        }
+
+        if(overlaps) {
+            continue;
+        }
+
+        for(int r=0; r<numberOfRoles; r++) {
+            this->used[group[r]] = 1;
+            groups.push_back(group[r]);
+        }
+
+        fits.push_back(allFits[ranking[i]]);
+        numberTaken++;
+    }
+
+    for(int g=0; g<numberTaken; g++) {
+        for(int r=0; r<numberOfRoles; r++) {
+            this->used[groups[groups.size() - ((g + 1) * numberOfRoles) + r]] = 0;
+        }
+    }
+
+    return numberTaken;
+}
+
+/**
+ * Measures where each placed contour sits in the group, and fills this->scores with how well each one fits each role.
+ * scores[(role * numberOfRoles) + member] is the fit of the contour placed in role "member" if it were given "role" 
+ * instead, or -1 if it would not pass. This is the same test that the target has always used: the contour must 
+ * pass the role's ExampleContour, and sit the right number of target widths from the center of the group.
+ */
+template<int ROLES>
+void TargetMatcher::ScoreGroup() {
+    const int numberOfRoles = RoleCount<ROLES>();
+    int fixedRows[ROLES > 0 ? ROLES : 1];
+    int *sortedRows = (ROLES > 0 ? fixedRows : this->sortedRows);
+
+    //the bounds are measured with the rows in order, so that every way of filling the roles measures the same
+    for(int r=0; r<numberOfRoles; r++) {
+        sortedRows[r] = this->chosen[r];
+    }
+
+    std::sort(sortedRows, sortedRows + numberOfRoles);
+    cv::Rect bounds = this->table->Bounds(sortedRows, numberOfRoles);
+    int centerX = (bounds.width / 2) + bounds.x;
+    int centerY = (bounds.height / 2) + bounds.y;
+    int objectWidth = bounds.width;
+
+    for(int member=0; member<numberOfRoles; member++) {
+        int row = this->chosen[member];
+
+        int distToCenterX = centerX - this->centerX[row];
+        double widthsToCenterX = distToCenterX / (double) objectWidth;
+
+        int distToCenterY = centerY - this->centerY[row];
+        double widthsToCenterY = (double) distToCenterY / (double) objectWidth;
+
+        for(int r=0; r<numberOfRoles; r++) {
+            bool distXValid = (widthsToCenterX > this->lowerX[r] && widthsToCenterX < this->upperX[r]);
+            bool distYValid = (widthsToCenterY > this->lowerY[r] && widthsToCenterY < this->upperY[r]);
+            double &score = this->scores[(r * numberOfRoles) + member];
+            if(distXValid && distYValid && this->accepted[(r * this->numberOfRows) + row]) {
+                double deviation = 
+                    this->shapeDeviations[(r * this->numberOfRows) + row] +
+                    Deviation(widthsToCenterX, this->lowerX[r], this->upperX[r]) +
+                    Deviation(widthsToCenterY, this->lowerY[r], this->upperY[r]);
+
+                score = 1 - (deviation / 5);
+            } else {
+                score = -1;
+            }
+        }
+    }
+}
+
+/**
+ * Gives each member of the placed group its own role so that the total fit is as high as possible, using the
+ * scores from ScoreGroup(). This is a small assignment problem, solved over every set of members given to the 
+ * first roles. Stores the member given to each role in this->assigned.
+ * @return The total fit, or -1 if the members can't all be given roles.
+ */
+template<int ROLES>
+double TargetMatcher::Assign() {
+    const int numberOfRoles = RoleCount<ROLES>();
+    double fixedTotals[ROLES > 0 ? 1 << ROLES : 1];
+    int fixedMembers[ROLES > 0 ? 1 << ROLES : 1];
+    double *bestTotals = (ROLES > 0 ? fixedTotals : this->bestTotals);
+    int *lastMembers = (ROLES > 0 ? fixedMembers : this->lastMembers);
+
+    int allMembers = (1 << numberOfRoles) - 1;
+    bestTotals[0] = 0;
+    for(int members=1; members<=allMembers; members++) {
+        bestTotals[members] = -1;
+    }
+
+    for(int members=0; members<allMembers; members++) {
+        if(bestTotals[members] < 0) {
+            continue;
+        }
+
+        //roles are given out in order, so the next role is the number of members given out already
+        int role = __builtin_popcount(members);
+        for(int member=0; member<numberOfRoles; member++) {
+            double score = this->scores[(role * numberOfRoles) + member];
+            if((members & (1 << member)) || score < 0) {
+                continue;
+            }
+
+            int next = members | (1 << member);
+            double total = bestTotals[members] + score;
+            if(total > bestTotals[next]) {
+                bestTotals[next] = total;
+                lastMembers[next] = member;
+            }
+        }
+    }
+
+    if(bestTotals[allMembers] < 0) {
+        return -1;
+    }
+
+    int members = allMembers;
+    for(int role=numberOfRoles - 1; role>=0; role--) {
+        int member = lastMembers[members];
+        this->assigned[role] = member;
+        members &= ~(1 << member);
+    }
+
+    return bestTotals[allMembers];
+}
+
+/**
+ * Puts "row" in the role filled at "depth", and keeps searching if the group can still fit.
+ */
+template<int ROLES>
+void TargetMatcher::Place(int depth, int row) {
+    const int numberOfRoles = RoleCount<ROLES>();
+    int role = this->order[depth];
+    double lower = this->widthLower[depth];
+    double upper = this->widthUpper[depth];
+
+    //the target is at least as wide as the distance between the left edges of its contours
+    int left = this->table->x[row];
+    this->leftMin[depth + 1] = (depth == 0 ? left : std::min(this->leftMin[depth], left));
+    this->leftMax[depth + 1] = (depth == 0 ? left : std::max(this->leftMax[depth], left));
+    lower = std::max(lower, (double) (this->leftMax[depth + 1] - this->leftMin[depth + 1]));
+
+    //every pair of placed contours limits how wide the target can be
+    for(int i=0; i<depth; i++) {
+        int placedRole = this->order[i];
+        int placedRow = this->chosen[placedRole];
+        bool possible =
+            NarrowWidth(
+                this->centerX[row] - this->centerX[placedRow],
+                this->lowerX[placedRole] - this->upperX[role],
+                this->upperX[placedRole] - this->lowerX[role],
+                lower, upper
+            ) &&
+            NarrowWidth(
+                this->centerY[row] - this->centerY[placedRow],
+                this->lowerY[placedRole] - this->upperY[role],
+                this->upperY[placedRole] - this->lowerY[role],
+                lower, upper
+            );
+
+        if(!possible) {
+            return;
+        }
+    }
+
+    if(lower > upper * (1 + WIDTH_SLACK) + WIDTH_SLACK) {
+        return;
+    }
+
+    this->chosen[role] = row;
+    this->used[row] = 1;
+    this->widthLower[depth + 1] = lower;
+    this->widthUpper[depth + 1] = upper;
+
+    if(depth + 1 == numberOfRoles) {
+        Report<ROLES>();
+    } else {
+        Extend<ROLES>(depth + 1);
+    }
+
+    this->used[row] = 0;
+}
+
+/**
+ * Tries every contour that could fill the role at "depth", given the contours already placed. Only the
+ * grid cells where such a contour could be centered are looked at.
+ */
+template<int ROLES>
+void TargetMatcher::Extend(int depth) {
+    int role = this->order[depth];
+    double lower = this->widthLower[depth];
+    double upper = this->widthUpper[depth];
+
+    //the window around the placed contours where this role's contour can be centered
+    double
+        windowLeft = -DBL_MAX,
+        windowRight = DBL_MAX,
+        windowTop = -DBL_MAX,
+        windowBottom = DBL_MAX;
+
+    for(int i=0; i<depth; i++) {
+        int placedRole = this->order[i];
+        int placedRow = this->chosen[placedRole];
+
+        double ratioLow = this->lowerX[placedRole] - this->upperX[role];
+        double ratioHigh = this->upperX[placedRole] - this->lowerX[role];
+        windowLeft = std::max(windowLeft, this->centerX[placedRow] + std::min(ratioLow * lower, ratioLow * upper));
+        windowRight = std::min(windowRight, this->centerX[placedRow] + std::max(ratioHigh * lower, ratioHigh * upper));
+
+        ratioLow = this->lowerY[placedRole] - this->upperY[role];
+        ratioHigh = this->upperY[placedRole] - this->lowerY[role];
+        windowTop = std::max(windowTop, this->centerY[placedRow] + std::min(ratioLow * lower, ratioLow * upper));
+        windowBottom = std::min(windowBottom, this->centerY[placedRow] + std::max(ratioHigh * lower, ratioHigh * upper));
+    }
+
+    if(windowLeft > windowRight || windowTop > windowBottom) {
+        return;
+    }
+
+    //one pixel of slack on each side so rounding never throws out a contour that fits
+    const double limit = INT_MAX / 2;
+    int left = (int) std::max(-limit, std::floor(windowLeft) - 1);
+    int right = (int) std::min(limit, std::ceil(windowRight) + 1);
+    int top = (int) std::max(-limit, std::floor(windowTop) - 1);
+    int bottom = (int) std::min(limit, std::ceil(windowBottom) + 1);
+
+    int firstColumn = ColumnOf(left);
+    int lastColumn = ColumnOf(right);
+    int firstRow = RowOf(top);
+    int lastRow = RowOf(bottom);
+
+    for(int gridRow=firstRow; gridRow<=lastRow; gridRow++) {
+        for(int column=firstColumn; column<=lastColumn; column++) {
+            int cell = (gridRow * this->gridColumns) + column;
+            for(int i=this->cellStart[cell]; i<this->cellStart[cell + 1]; i++) {
+                int row = this->cellRows[i];
+                if(this->used[row] || !this->accepted[(role * this->numberOfRows) + row]) {
+                    continue;
+                }
+
+                if(this->centerX[row] < left || this->centerX[row] > right ||
+                   this->centerY[row] < top || this->centerY[row] > bottom) {
+                    continue;
+                }
+
+                if(!Expand()) {
+                    return;
+                }
+
+                Place<ROLES>(depth, row);
+            }
+        }
+    }
+}
+
+/**
+ * Counts one more contour tried. Returns false once the search has tried MAX_EXPANSIONS contours.
+ */
+bool TargetMatcher::Expand() {
+    if(this->expansions >= MAX_EXPANSIONS) {
+        this->capped = true;
+        return false;
+    }
+
+    this->expansions++;
+    return true;
+}
+
+/**
+ * Reports the placed group if every contour passes the role it was placed in, and no other way of giving
+ * the contours roles fits better. The search tries every way, so the group is reported exactly once, 
+ * in the roles that fit it best. Groups too big for Assign() are reported in every way that passes.
+ */
+template<int ROLES>
+void TargetMatcher::Report() {
+    const int numberOfRoles = RoleCount<ROLES>();
+    ScoreGroup<ROLES>();
+
+    double total = 0;
+    for(int r=0; r<numberOfRoles; r++) {
+        double score = this->scores[(r * numberOfRoles) + r];
+        if(score < 0) {
+            return;
+        }
+        total += score;
+    }
+
+    if(numberOfRoles <= MAX_ASSIGNED_ROLES) {
+        total = Assign<ROLES>();
+        for(int r=0; r<numberOfRoles; r++) {
+            if(this->assigned[r] != r) {
+                return;
+            }
+        }
+    }
+
+    for(int r=0; r<numberOfRoles; r++) {
+        this->groups->push_back(this->chosen[r]);
+    }
+
+    this->fits->push_back(total / numberOfRoles);
+    this->groupsFound++;
+}
+
+/**
+ * Returns the grid column that "x" falls in, clamped to the grid.
+ */
+int TargetMatcher::ColumnOf(int x) {
+    long column = ((long) x - this->gridX) / this->cellWidth;
+    return (int) std::max(0L, std::min(column, (long) this->gridColumns - 1));
+}
+
+/**
+ * Returns the grid row that "y" falls in, clamped to the grid.
+ */
+int TargetMatcher::RowOf(int y) {
+    long row = ((long) y - this->gridY) / this->cellHeight;
+    return (int) std::max(0L, std::min(row, (long) this->gridRows - 1));
+}
+
+/**
+ * Returns the grid cell that a contour centered at (x, y) goes in.
+ */
+int TargetMatcher::CellOf(int x, int y) {
+    return (RowOf(y) * this->gridColumns) + ColumnOf(x);
+}
+
+//the versions for fixed sizes are picked by BestGroupsFor(), and the generic ones work for any size
+template int TargetMatcher::FindGroups<0>(ArenaVector<int> &groups, ArenaVector<double> &fits);
+template int TargetMatcher::FindBestGroups<0>(ArenaVector<int> &groups, ArenaVector<double> &fits, int maxGroups);
+template int TargetMatcher::FindBestGroups<1>(ArenaVector<int> &groups, ArenaVector<double> &fits, int maxGroups);
+template int TargetMatcher::FindBestGroups<2>(ArenaVector<int> &groups, ArenaVector<double> &fits, int maxGroups);
+template int TargetMatcher::FindBestGroups<3>(ArenaVector<int> &groups, ArenaVector<double> &fits, int maxGroups);
@@ -0,0 +1,169 @@
+#include "Runner.h"
+
+/**
+ * Source file for the TargetPacket class.
+ * Written By: Brach Knutson
+ */
+
+using namespace cv;
+using namespace KiwiLight;
+
+const int TargetPacket::MAGIC = 0x4B4C; //"KL"
+const int TargetPacket::VERSION = 1;
+const int TargetPacket::HEADER_SIZE = 24;
+const int TargetPacket::TARGET_SIZE = 36;
+
+const int TargetPacket::SENT = 1;
+const int TargetPacket::PREDICTED = 2;
+const int TargetPacket::TRACKED = 4;
+
+/**
+ * Creates a new, empty TargetPacket.
+ */
+TargetPacket::TargetPacket() {
+    this->Clear(0, 0, 0);
+}
+
+/**
+ * Empties the packet and starts it over with a new header.
+ * @param sequence The number of the packet. It should go up by one for every packet sent.
+ * @param timestamp When the frame the packet describes was captured, from Clock::GetMonotonicTime().
+ * @param latency Microseconds from the capture of the frame to the packet being sent.
+ */
+void TargetPacket::Clear(uint32_t sequence, long long timestamp, long latency) {
+    this->sequence = sequence;
+    this->timestamp = timestamp;
+    this->latency = latency;
+    this->numberOfTargets = 0;
+}
+
+/**
+ * Adds a target to the packet.
+ * @return True if the target was added, false if the packet already has MAX_TARGETS targets.
+ */
+bool TargetPacket::Add(PacketTarget target) {
+    if(this->numberOfTargets >= MAX_TARGETS) {
+        return false;
+    }
+
+    this->targets[this->numberOfTargets] = target;
+    this->numberOfTargets++;
+    return true;
+}
+
+/**
+ * Writes the packet into "bytes", replacing what was there. The string's memory is reused.
+ */
+void TargetPacket::Encode(std::string &bytes) {
+    bytes.resize(HEADER_SIZE + (this->numberOfTargets * TARGET_SIZE));
+    unsigned char *out = (unsigned char*) &bytes[0];
+
+    PutUnsigned(out, MAGIC, 2);
+    PutUnsigned(out + 2, VERSION, 1);
+    PutUnsigned(out + 3, HEADER_SIZE, 1);
+    PutUnsigned(out + 4, this->sequence, 4);
+    PutUnsigned(out + 8, (uint64_t) this->timestamp, 8);
+    PutUnsigned(out + 16, (uint32_t) std::max(std::min(this->latency, (long) UINT32_MAX), 0L), 4);
+    PutUnsigned(out + 20, this->numberOfTargets, 1);
+    PutUnsigned(out + 21, TARGET_SIZE, 1);
+    PutUnsigned(out + 22, 0, 2);
+
+    for(int i=0; i<this->numberOfTargets; i++) {
+        PacketTarget &target = this->targets[i];
+        unsigned char *at = out + HEADER_SIZE + (i * TARGET_SIZE);
+        PutUnsigned(at, (uint16_t) target.id, 2);
+        PutUnsigned(at + 2, target.flags, 1);
+        PutUnsigned(at + 3, 0, 1);
+        PutFloat(at + 4, target.x);
+        PutFloat(at + 8, target.y);
+        PutFloat(at + 12, target.width);
+        PutFloat(at + 16, target.height);
+        PutFloat(at + 20, target.distance);
+        PutFloat(at + 24, target.horizontalAngle);
+        PutFloat(at + 28, target.verticalAngle);
+        PutFloat(at + 32, target.fit);
+    }
+}
+
+/**
+ * Reads a packet made by Encode() into this one. Packets from later versions are read as far as this version understands them.
+ * @param bytes The packet.
+ * @param size The number of bytes in the packet.
+ * @return True if the packet was read, false if it is not a TargetPacket or is cut short. This packet is untouched if false.
+ */
+bool TargetPacket::Decode(const char *bytes, int size) {
+    const unsigned char *in = (const unsigned char*) bytes;
+    if(size < HEADER_SIZE || GetUnsigned(in, 2) != MAGIC || GetUnsigned(in + 2, 1) < VERSION) {
+        return false;
+    }
+
+    int headerSize = GetUnsigned(in + 3, 1);
+    int numberOfTargets = GetUnsigned(in + 20, 1);
+    int targetSize = GetUnsigned(in + 21, 1);
+    if(headerSize < HEADER_SIZE || targetSize < TARGET_SIZE || size < headerSize + (numberOfTargets * targetSize)) {
+        return false;
+    }
+
+    this->Clear(GetUnsigned(in + 4, 4), (long long) GetUnsigned(in + 8, 8), GetUnsigned(in + 16, 4));
+    for(int i=0; i<numberOfTargets; i++) {
+        const unsigned char *at = in + headerSize + (i * targetSize);
+        PacketTarget target;
+        target.id = (int16_t) GetUnsigned(at, 2);
+        target.flags = GetUnsigned(at + 2, 1);
+        target.x = GetFloat(at + 4);
+        target.y = GetFloat(at + 8);
+        target.width = GetFloat(at + 12);
+        target.height = GetFloat(at + 16);
+        target.distance = GetFloat(at + 20);
+        target.horizontalAngle = GetFloat(at + 24);
+        target.verticalAngle = GetFloat(at + 28);
+        target.fit = GetFloat(at + 32);
+
+        if(!this->Add(target)) {
+            break;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Writes the lowest "bytes" bytes of "value" at "at", most significant byte first.
+ */
+void TargetPacket::PutUnsigned(unsigned char *at, uint64_t value, int bytes) {
+    for(int i=bytes - 1; i>=0; i--) {
+        at[i] = (unsigned char) (value & 0xFF);
+        value >>= 8;
+    }
+}
+
+/**
+ * Reads a "bytes" byte number from "at", most significant byte first.
+ */
+uint64_t TargetPacket::GetUnsigned(const unsigned char *at, int bytes) {
+    uint64_t value = 0;
+    for(int i=0; i<bytes; i++) {
+        value = (value << 8) | at[i];
+    }
+
+    return value;
+}
+
+/**
+ * Writes "value" at "at" as a big-endian IEEE 754 float.
+ */
+void TargetPacket::PutFloat(unsigned char *at, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    PutUnsigned(at, bits, 4);
+}
+
+/**
+ * Reads a big-endian IEEE 754 float from "at".
+ */
+float TargetPacket::GetFloat(const unsigned char *at) {
+    uint32_t bits = GetUnsigned(at, 4);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
@@ -0,0 +1,359 @@
+#include "Runner.h"
+
+/**
+ * Source file for the TargetTracker class.
+ * Written By: Brach Knutson
+ */
+
+using namespace cv;
+using namespace KiwiLight;
+
+const int TargetTracker::DEFAULT_CONFIRM_FRAMES = 3;
+const int TargetTracker::DEFAULT_COAST_FRAMES = 5;
+const int TargetTracker::MAX_TRACKS = 16;
+
+const double TargetTracker::MEASUREMENT_NOISE = 2.0;        //pixels
+const double TargetTracker::ACCELERATION_NOISE = 400.0;     //pixels per second squared
+const double TargetTracker::INITIAL_VELOCITY_NOISE = 200.0; //pixels per second
+const double TargetTracker::GATE = 18.47;                   //99.9% of a chi-squared distribution with 4 degrees of freedom
+const double TargetTracker::MAX_PREDICTION_SECONDS = 0.5;
+
+/**
+ * Starts the filter at "position", not moving.
+ * @param position The first measurement.
+ * @param positionVariance How uncertain the first measurement is.
+ * @param velocityVariance How uncertain the velocity is, since it has not been measured yet.
+ */
+void TrackAxis::Reset(double position, double positionVariance, double velocityVariance) {
+    this->position = position;
+    this->velocity = 0;
+    this->positionVariance = positionVariance;
+    this->covariance = 0;
+    this->velocityVariance = velocityVariance;
+}
+
+/**
+ * Moves the filter forward in time, assuming the velocity stays the same apart from random acceleration.
+ * @param seconds How far to move forward.
+ * @param accelerationVariance How much the acceleration is expected to vary.
+ */
+void TrackAxis::Predict(double seconds, double accelerationVariance) {
+    double seconds2 = seconds * seconds;
+    this->position += this->velocity * seconds;
+
+    //P = FPF' + Q, where Q comes from acceleration that is constant over the step
+    this->positionVariance += (2 * seconds * this->covariance) + (seconds2 * this->velocityVariance) + (accelerationVariance * seconds2 * seconds2 / 4);
+    this->covariance += (seconds * this->velocityVariance) + (accelerationVariance * seconds2 * seconds / 2);
+    this->velocityVariance += accelerationVariance * seconds2;
+}
+
+/**
+ * Corrects the filter with a measurement of the position.
+ * @param measurement The measured position.
+ * @param measurementVariance How uncertain the measurement is.
+ */
+void TrackAxis::Correct(double measurement, double measurementVariance) {
+    double innovationVariance = this->positionVariance + measurementVariance;
+    double positionGain = this->positionVariance / innovationVariance;
+    double velocityGain = this->covariance / innovationVariance;
+    double residual = measurement - this->position;
+
+    this->position += positionGain * residual;
+    this->velocity += velocityGain * residual;
+
+    //P = (I - KH)P
+    this->velocityVariance -= velocityGain * this->covariance;
+    this->covariance *= (1 - positionGain);
+    this->positionVariance *= (1 - positionGain);
+}
+
+/**
+ * Creates a new TargetTracker that is turned off.
+ */
+TargetTracker::TargetTracker()
+ : TargetTracker(false, DEFAULT_CONFIRM_FRAMES, DEFAULT_COAST_FRAMES) {
+}
+
+/**
+ * Creates a new TargetTracker.
+ * @param enabled True if targets should be tracked, false to send whatever is found in each frame.
+ * @param confirmFrames The number of frames in a row a target has to be seen in before it is sent.
+ * @param coastFrames The number of frames in a row a sent target can be missing before it is dropped.
+ */
+TargetTracker::TargetTracker(bool enabled, int confirmFrames, int coastFrames) {
+    this->enabled = enabled;
+    this->confirmFrames = std::max(confirmFrames, 1);
+    this->coastFrames = std::max(coastFrames, 0);
+    this->nextTrackId = 0;
+    this->selectedTrack = -1;
+    this->lastTimestamp = 0;
+    this->frameInterval = 0;
+    this->tracksStarted = 0;
+    this->framesSent = 0;
+    this->framesCoasted = 0;
+    this->tracks.reserve(MAX_TRACKS);
+}
+
+/**
+ * Tells the tracker about the targets found in a frame. Every track is predicted to the time of the frame,
+ * each target is matched to the closest track that predicted it, and targets that no track predicted start new tracks.
+ * @param timestamp When the frame was captured, from Clock::GetMonotonicTime().
+ * @param targets The targets found in the frame.
+ * @param preferred The index of the target that should be sent if the sent track is lost, or -1.
+ */
+void TargetTracker::Update(long long timestamp, std::vector<Target> &targets, int preferred) {
+    if(!this->enabled) {
+        return;
+    }
+
+    double seconds = 0;
+    if(this->lastTimestamp > 0 && timestamp > this->lastTimestamp) {
+        this->frameInterval = timestamp - this->lastTimestamp;
+        seconds = std::min(this->frameInterval / 1000000.0, MAX_PREDICTION_SECONDS);
+    }
+
+    this->lastTimestamp = timestamp;
+    double accelerationVariance = ACCELERATION_NOISE * ACCELERATION_NOISE;
+    for(int i=0; i<this->tracks.size(); i++) {
+        for(int k=0; k<TargetTrack::AXES; k++) {
+            this->tracks[i].axes[k].Predict(seconds, accelerationVariance);
+        }
+
+        //Correct() clears this again if the track is seen
+        this->tracks[i].misses++;
+    }
+
+    //pair the targets with every track of the same ExampleTarget that could have produced them, then hand out the closest pairs first
+    this->pairings.clear();
+    for(int i=0; i<this->tracks.size(); i++) {
+        for(int j=0; j<targets.size(); j++) {
+            if(this->tracks[i].last.ID() != targets[j].ID()) {
+                continue;
+            }
+
+            double distance = this->Distance(this->tracks[i], targets[j]);
+            if(distance < GATE) {
+                Pairing pairing = { i, j, distance };
+                this->pairings.push_back(pairing);
+            }
+        }
+    }
+
+    std::sort(this->pairings.begin(), this->pairings.end());
+    this->trackOfTarget.assign(targets.size(), -1);
+    for(int i=0; i<this->pairings.size(); i++) {
+        Pairing pairing = this->pairings[i];
+        TargetTrack &track = this->tracks[pairing.track];
+        if(track.misses == 0 || this->trackOfTarget[pairing.target] >= 0) {
+            continue; //the track or the target was already matched to something closer
+        }
+
+        this->Correct(track, targets[pairing.target]);
+        this->trackOfTarget[pairing.target] = track.id;
+    }
+
+    for(int i=0; i<targets.size(); i++) {
+        if(this->trackOfTarget[i] < 0 && this->tracks.size() < MAX_TRACKS) {
+            this->StartTrack(targets[i]);
+            this->trackOfTarget[i] = this->tracks.back().id;
+        }
+    }
+
+    //unconfirmed tracks are dropped as soon as they are missed, and confirmed tracks once they have coasted too long
+    int kept = 0;
+    for(int i=0; i<this->tracks.size(); i++) {
+        TargetTrack &track = this->tracks[i];
+        bool lost = track.misses > 0 && (!track.confirmed || track.misses > this->coastFrames);
+        if(!lost) {
+            if(kept != i) {
+                this->tracks[kept] = track;
+            }
+
+            kept++;
+        }
+    }
+
+    this->tracks.resize(kept);
+
+    int preferredTrack = (preferred >= 0 && preferred < this->trackOfTarget.size() ? this->trackOfTarget[preferred] : -1);
+    this->Select(preferredTrack);
+
+    int selected = this->FindTrack(this->selectedTrack);
+    if(selected >= 0) {
+        this->framesSent++;
+        if(this->tracks[selected].misses > 0) {
+            this->framesCoasted++;
+        }
+    }
+}
+
+/**
+ * Finds where the sent track is at "timestamp", and stores it in "estimate".
+ * @param timestamp The time to find the target at, from Clock::GetMonotonicTime(). This can be after the last frame, to predict ahead.
+ * @param estimate Where to store the target. Its contours are the ones last matched to the track.
+ * @return True if a track is being sent, false otherwise. "estimate" is untouched if this is false.
+ */
+bool TargetTracker::Estimate(long long timestamp, Target &estimate) {
+    int selected = this->FindTrack(this->selectedTrack);
+    if(!this->enabled || selected < 0) {
+        return false;
+    }
+
+    double seconds = std::max(std::min((timestamp - this->lastTimestamp) / 1000000.0, MAX_PREDICTION_SECONDS), 0.0);
+    TargetTrack &track = this->tracks[selected];
+    estimate = track.last;
+    estimate.SetBounds(BoundsAt(track, seconds));
+    return true;
+}
+
+/**
+ * Returns the area that every track is expected to be in by the next frame, or an empty rectangle if there are no tracks.
+ */
+cv::Rect TargetTracker::NextBounds() {
+    cv::Rect bounds = cv::Rect();
+    if(!this->enabled) {
+        return bounds;
+    }
+
+    double seconds = std::min(this->frameInterval / 1000000.0, MAX_PREDICTION_SECONDS);
+    for(int i=0; i<this->tracks.size(); i++) {
+        bounds |= BoundsAt(this->tracks[i], seconds);
+    }
+
+    return bounds;
+}
+
+/**
+ * Returns a human readable summary of how many tracks were started and how often a lost target was predicted.
+ */
+std::string TargetTracker::Summary() {
+    double coastedPercent = (this->framesSent > 0 ? this->framesCoasted * 100.0 / this->framesSent : 0);
+    return std::to_string(this->tracksStarted) + " tracks started, " + std::to_string(this->framesSent) + " frames sent from a track (" + std::to_string(coastedPercent) + "% predicted while lost)";
+}
+
+/**
+ * Stores the values that the tracks filter for "target" in "measurements": center x, center y, width, and height.
+ */
+void TargetTracker::MeasurementsOf(Target &target, double measurements[]) {
+    cv::Rect bounds = target.Bounds();
+    measurements[0] = target.Center().x;
+    measurements[1] = target.Center().y;
+    measurements[2] = bounds.width;
+    measurements[3] = bounds.height;
+}
+
+/**
+ * Returns the bounds of "track", predicted "seconds" past the last frame.
+ */
+cv::Rect TargetTracker::BoundsAt(TargetTrack &track, double seconds) {
+    double centerX = track.axes[0].At(seconds);
+    double centerY = track.axes[1].At(seconds);
+    double width = std::max(track.axes[2].At(seconds), 1.0);
+    double height = std::max(track.axes[3].At(seconds), 1.0);
+    return cv::Rect((int) round(centerX - (width / 2)), (int) round(centerY - (height / 2)), (int) round(width), (int) round(height));
+}
+
+/**
+ * Returns how far "target" is from where "track" predicted it would be, in standard deviations squared.
+ */
+double TargetTracker::Distance(TargetTrack &track, Target &target) {
+    double measurements[TargetTrack::AXES];
+    MeasurementsOf(target, measurements);
+
+    double measurementVariance = MEASUREMENT_NOISE * MEASUREMENT_NOISE;
+    double distance = 0;
+    for(int i=0; i<TargetTrack::AXES; i++) {
+        TrackAxis &axis = track.axes[i];
+        double residual = measurements[i] - axis.position;
+        distance += (residual * residual) / (axis.positionVariance + measurementVariance);
+    }
+
+    return distance;
+}
+
+/**
+ * Corrects "track" with "target", which was seen in the latest frame.
+ */
+void TargetTracker::Correct(TargetTrack &track, Target &target) {
+    double measurements[TargetTrack::AXES];
+    MeasurementsOf(target, measurements);
+
+    double measurementVariance = MEASUREMENT_NOISE * MEASUREMENT_NOISE;
+    for(int i=0; i<TargetTrack::AXES; i++) {
+        track.axes[i].Correct(measurements[i], measurementVariance);
+    }
+
+    track.last = target;
+    track.hits++;
+    track.misses = 0;
+    track.confirmed = track.confirmed || track.hits >= this->confirmFrames;
+}
+
+/**
+ * Starts a new track at "target".
+ */
+void TargetTracker::StartTrack(Target &target) {
+    double measurements[TargetTrack::AXES];
+    MeasurementsOf(target, measurements);
+
+    this->tracks.push_back(TargetTrack());
+    TargetTrack &track = this->tracks.back();
+    for(int i=0; i<TargetTrack::AXES; i++) {
+        track.axes[i].Reset(measurements[i], MEASUREMENT_NOISE * MEASUREMENT_NOISE, INITIAL_VELOCITY_NOISE * INITIAL_VELOCITY_NOISE);
+    }
+
+    track.id = this->nextTrackId++;
+    track.last = target;
+    track.hits = 1;
+    track.misses = 0;
+    track.confirmed = track.hits >= this->confirmFrames;
+    this->tracksStarted++;
+}
+
+/**
+ * Returns the index of the track with the given id, or -1 if there is none.
+ */
+int TargetTracker::FindTrack(int id) {
+    for(int i=0; i<this->tracks.size(); i++) {
+        if(this->tracks[i].id == id) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Picks the track to send. The sent track stays the same until it is lost. Then the track of the preferred
+ * target is sent if it is confirmed, or else the confirmed track that is being seen and has been seen the most.
+ * @param preferredTrack The id of the track of the target the Runner would send without tracking, or -1.
+ */
+void TargetTracker::Select(int preferredTrack) {
+    int selected = this->FindTrack(this->selectedTrack);
+    if(selected >= 0 && this->tracks[selected].confirmed) {
+        return;
+    }
+
+    this->selectedTrack = -1;
+    int preferred = this->FindTrack(preferredTrack);
+    if(preferred >= 0 && this->tracks[preferred].confirmed) {
+        this->selectedTrack = preferredTrack;
+        return;
+    }
+
+    int best = -1;
+    for(int i=0; i<this->tracks.size(); i++) {
+        TargetTrack &track = this->tracks[i];
+        if(!track.confirmed) {
+            continue;
+        }
+
+        if(best < 0 || track.misses < this->tracks[best].misses || (track.misses == this->tracks[best].misses && track.hits > this->tracks[best].hits)) {
+            best = i;
+        }
+    }
+
+    if(best >= 0) {
+        this->selectedTrack = this->tracks[best].id;
+    }
+}
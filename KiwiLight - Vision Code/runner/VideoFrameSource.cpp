@@ -0,0 +1,35 @@
+#include "Runner.h"
+
+/**
+ * Source file for the VideoFrameSource class.
+ * Written By: Brach Knutson
+ */
+
+using namespace cv;
+using namespace KiwiLight;
+
+/**
+ * Creates a new VideoFrameSource.
+ * @param fileName The path to the video file to read.
+ */
+VideoFrameSource::VideoFrameSource(std::string fileName) {
+    this->fileName = fileName;
+    this->video = VideoCapture(fileName);
+
+    if(!this->video.isOpened()) {
+        std::cout << "WARNING: The video file \"" << fileName << "\" could not be opened!" << std::endl;
+    }
+}
+
+/**
+ * Decodes the next frame of the video.
+ * @return The frame, or an empty Mat at the end of the video.
+ */
+cv::Mat VideoFrameSource::ReadFrame() {
+    cv::Mat frame;
+    if(this->video.isOpened()) {
+        this->video.read(frame);
+    }
+
+    return frame;
+}
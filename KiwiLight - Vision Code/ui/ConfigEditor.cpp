@@ -307,6 +307,13 @@ std::string ConfigEditor::GetLastFrameResult() {
     return this->lastIterationResult;
 }
 
+/**
+ * Returns what should be sent to the RIO for the last runner iteration, in the protocol the config uses.
+ */
+std::string ConfigEditor::GetLastFramePacket() {
+    return this->runner.GetLastFramePacket();
+}
+
 /**
  * Causes the editor to save the config to it's file.
  */
@@ -373,6 +380,54 @@ bool ConfigEditor::Save() {
                     constantResize.AddTag(resizeHeight);
 
                 configuration.AddTag(constantResize);
+
+            /**
+             * <configuration>
+             *  <regionTracking>
+             */
+            RegionTracker tracker = this->runner.GetRegionTracker();
+            XMLTag regionTracking = XMLTag("regionTracking");
+                XMLTagAttribute trackingEnabled = XMLTagAttribute("enabled", (tracker.Enabled() ? "true" : "false"));
+                    regionTracking.AddAttribute(trackingEnabled);
+
+                XMLTag trackingPadding = XMLTag("padding", std::to_string(tracker.Padding()));
+                    regionTracking.AddTag(trackingPadding);
+
+                XMLTag trackingRefresh = XMLTag("refresh", std::to_string(tracker.RefreshFrames()));
+                    regionTracking.AddTag(trackingRefresh);
+
+                configuration.AddTag(regionTracking);
+
+            /**
+             * <configuration>
+             *  <targetTracking>
+             */
+            TargetTracker targetTracker = this->runner.GetTargetTracker();
+            XMLTag targetTracking = XMLTag("targetTracking");
+                XMLTagAttribute targetTrackingEnabled = XMLTagAttribute("enabled", (targetTracker.Enabled() ? "true" : "false"));
+                    targetTracking.AddAttribute(targetTrackingEnabled);
+
+                XMLTag targetTrackingConfirm = XMLTag("confirm", std::to_string(targetTracker.ConfirmFrames()));
+                    targetTracking.AddTag(targetTrackingConfirm);
+
+                XMLTag targetTrackingCoast = XMLTag("coast", std::to_string(targetTracker.CoastFrames()));
+                    targetTracking.AddTag(targetTrackingCoast);
+
+                configuration.AddTag(targetTracking);
+
+            /**
+             * <configuration>
+             *  <pyramid>
+             */
+            int pyramidScale = this->runner.GetPyramidScale();
+            XMLTag pyramid = XMLTag("pyramid");
+                XMLTagAttribute pyramidEnabled = XMLTagAttribute("enabled", (pyramidScale > 1 ? "true" : "false"));
+                    pyramid.AddAttribute(pyramidEnabled);
+
+                XMLTag pyramidScaleTag = XMLTag("scale", std::to_string(pyramidScale));
+                    pyramid.AddTag(pyramidScaleTag);
+
+                configuration.AddTag(pyramid);
                                 
             /**
              * <configuration>
@@ -381,6 +436,9 @@ bool ConfigEditor::Save() {
             XMLTag preprocessor = XMLTag("preprocessor");
                 XMLTagAttribute preprocessorType = XMLTagAttribute("type", (this->preprocessorSettings.GetProperty(PreProcessorProperty::IS_FULL) == 1.0 ? "full" : "partial"));
                     preprocessor.AddAttribute(preprocessorType);
+
+                XMLTagAttribute preprocessorMorphology = XMLTagAttribute("morphology", (this->runner.GetPreprocessorProperty(PreProcessorProperty::MASK_MORPHOLOGY) == 1.0 ? "mask" : "color"));
+                    preprocessor.AddAttribute(preprocessorMorphology);
                     
                 //<threshold>
                 XMLTag threshold = XMLTag("threshold", std::to_string((int) this->preprocessorSettings.GetProperty(PreProcessorProperty::THRESHOLD)));
@@ -425,7 +483,7 @@ bool ConfigEditor::Save() {
             XMLTag postprocessor = XMLTag("postprocessor");
                 //<target>
                 XMLTag target = XMLTag("target");
-                    XMLTagAttribute targetID = XMLTagAttribute("id", "0"); //this remains constant for now until multiple target support is added.
+                    XMLTagAttribute targetID = XMLTagAttribute("id", std::to_string(this->runner.GetExampleTarget().ID()));
                         target.AddAttribute(targetID);
                     
                     for(int i=0; i<this->postprocessorSettings.GetNumContours(); i++) {
@@ -503,6 +561,12 @@ bool ConfigEditor::Save() {
                         target.AddTag(calcByHeight);
 
                     postprocessor.AddTag(target);
+
+                //the editor only changes the first target, so any others are saved as they were loaded
+                std::vector<ExampleTarget> otherTargets = this->runner.GetPostProcessor().GetTargets();
+                for(int i=1; i<otherTargets.size(); i++) {
+                    postprocessor.AddTag(otherTargets[i].EncodeXMLTag());
+                }
                                     
                 /**
                  * <configuration>
@@ -517,6 +581,22 @@ bool ConfigEditor::Save() {
                     //<port>
                     XMLTag port = XMLTag("port", std::to_string(this->runnerSettings.GetUDPPort()));
                         UDP.AddTag(port);
+
+                    //<sendAge>
+                    XMLTag sendAge = XMLTag("sendAge", (this->runner.GetSendAge() ? "true" : "false"));
+                        UDP.AddTag(sendAge);
+
+                    //<protocol>
+                    XMLTag protocol = XMLTag("protocol", (this->runner.GetSendBinary() ? "binary" : "text"));
+                        UDP.AddTag(protocol);
+
+                    //<destination port="">
+                    std::vector<UDPDestination> destinations = this->runner.GetUDPDestinations();
+                    for(int i=0; i<destinations.size(); i++) {
+                        XMLTag destination = XMLTag("destination", destinations[i].address);
+                        destination.AddAttribute(XMLTagAttribute("port", std::to_string(destinations[i].port)));
+                        UDP.AddTag(destination);
+                    }
                         
                     postprocessor.AddTag(UDP);
                 configuration.AddTag(postprocessor);
@@ -236,8 +236,8 @@ void OverviewPanel::SetTargetInformationLabelsFromString(std::string iterOutput)
     std::string trimmedOutput = iterOutput.substr(1, iterOutput.length() - 2); //sub off the ':' and ';' at beginning and end
     std::vector<std::string> splitOutput = StringUtils::SplitString(trimmedOutput, ',');
 
-    //there must be 5 nums in string, no more, no less
-    if(splitOutput.size() == 7) {
+    //the first seven numbers describe the target. Tracking and the frame's age add more after them
+    if(splitOutput.size() >= 7) {
         int targetX = std::stoi(splitOutput[0]);
         int targetY = std::stoi(splitOutput[1]);
         int targetWidth = std::stoi(splitOutput[2]);
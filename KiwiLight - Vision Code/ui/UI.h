@@ -702,6 +702,7 @@ namespace KiwiLight {
         void Update();
         bool UpdateImageOnly();
         std::string GetLastFrameResult();
+        std::string GetLastFramePacket();
         bool Save();
         void Close();
         void StartLearningTarget();
@@ -0,0 +1,71 @@
+#include "Util.h"
+#include <new>
+
+/**
+ * Source file for the AllocationCounter class.
+ * Written By: Brach Knutson
+ * 
+ * When KIWILIGHT_COUNT_ALLOCATIONS is defined, this file replaces the global operator new and delete so that
+ * every heap allocation made by KiwiLight (and the standard library) is counted on the thread that made it.
+ * Memory that OpenCV allocates internally with cv::fastMalloc() is not counted.
+ */
+
+using namespace KiwiLight;
+
+#ifdef KIWILIGHT_COUNT_ALLOCATIONS
+
+static thread_local long long allocationsOnThisThread = 0;
+
+/**
+ * Counts and performs one allocation for the replaced operator new.
+ */
+static void *CountedAllocate(size_t bytes) {
+    allocationsOnThisThread++;
+    void *memory = malloc(bytes > 0 ? bytes : 1);
+    if(!memory) {
+        throw std::bad_alloc();
+    }
+
+    return memory;
+}
+
+void *operator new(size_t bytes) { return CountedAllocate(bytes); }
+void *operator new[](size_t bytes) { return CountedAllocate(bytes); }
+void *operator new(size_t bytes, const std::nothrow_t&) noexcept { allocationsOnThisThread++; return malloc(bytes > 0 ? bytes : 1); }
+void *operator new[](size_t bytes, const std::nothrow_t&) noexcept { allocationsOnThisThread++; return malloc(bytes > 0 ? bytes : 1); }
+void operator delete(void *memory) noexcept { free(memory); }
+void operator delete[](void *memory) noexcept { free(memory); }
+void operator delete(void *memory, size_t bytes) noexcept { free(memory); }
+void operator delete[](void *memory, size_t bytes) noexcept { free(memory); }
+
+/**
+ * Returns true because allocations are being counted.
+ */
+bool AllocationCounter::Enabled() {
+    return true;
+}
+
+/**
+ * Returns the number of heap allocations the calling thread has made since it started.
+ */
+long long AllocationCounter::Count() {
+    return allocationsOnThisThread;
+}
+
+#else
+
+/**
+ * Returns false because allocations are not being counted in this build.
+ */
+bool AllocationCounter::Enabled() {
+    return false;
+}
+
+/**
+ * Always returns 0 because allocations are not being counted in this build.
+ */
+long long AllocationCounter::Count() {
+    return 0;
+}
+
+#endif
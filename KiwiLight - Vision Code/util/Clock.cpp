@@ -39,6 +39,14 @@ long Clock::GetSystemTime() {
 	return ms.count();
 }
 
+/**
+ * Returns the number of microseconds on a clock that never jumps, for measuring when things happened 
+ * relative to each other. Unrelated to the time of day.
+ */
+long long Clock::GetMonotonicTime() {
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
 /**
  * Returns the current date.
  * Format: MM-DD-YYYY-HH-MM-SS
@@ -0,0 +1,128 @@
+#include "Util.h"
+
+/**
+ * Source file for the FrameArena class.
+ * Written By: Brach Knutson
+ */
+
+using namespace KiwiLight;
+
+const size_t FrameArena::DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+/**
+ * Creates a new empty FrameArena with the default block size.
+ */
+FrameArena::FrameArena() 
+ : FrameArena(DEFAULT_BLOCK_SIZE) {
+}
+
+/**
+ * Creates a new empty FrameArena. No memory is taken until the first allocation.
+ * @param blockSize The size of each block of memory taken from the heap, in bytes.
+ */
+FrameArena::FrameArena(size_t blockSize) {
+    this->blockSize = std::max(blockSize, (size_t) 1);
+    this->currentBlock = 0;
+    this->offset = 0;
+}
+
+/**
+ * Creates a new empty FrameArena with the same block size as "other". Memory is never shared between arenas.
+ */
+FrameArena::FrameArena(const FrameArena &other) 
+ : FrameArena(other.blockSize) {
+}
+
+/**
+ * Empties this arena and takes the block size of "other". Memory is never shared between arenas.
+ */
+FrameArena &FrameArena::operator=(const FrameArena &other) {
+    if(this != &other) {
+        Release();
+        this->blockSize = other.blockSize;
+    }
+
+    return *this;
+}
+
+/**
+ * Gives all of the arena's memory back to the heap.
+ */
+FrameArena::~FrameArena() {
+    Release();
+}
+
+/**
+ * Takes "bytes" bytes from the arena. The memory stays valid until the next Reset().
+ * @param bytes The number of bytes needed.
+ * @param alignment The alignment needed, in bytes. Must be a power of two.
+ */
+void *FrameArena::Allocate(size_t bytes, size_t alignment) {
+    while(this->currentBlock < this->blocks.size()) {
+        uintptr_t address = (uintptr_t) (this->blocks[this->currentBlock] + this->offset);
+        size_t padding = (alignment - (address % alignment)) % alignment;
+        if(this->offset + padding + bytes <= this->blockSizes[this->currentBlock]) {
+            void *memory = this->blocks[this->currentBlock] + this->offset + padding;
+            this->offset += padding + bytes;
+            return memory;
+        }
+
+        //this block is full for this frame, try the next one
+        this->currentBlock++;
+        this->offset = 0;
+    }
+
+    //every block is full, so the arena has to grow. This only happens until it has seen its biggest frame.
+    size_t newBlockSize = std::max(this->blockSize, bytes + alignment);
+    this->blocks.push_back(new char[newBlockSize]);
+    this->blockSizes.push_back(newBlockSize);
+    this->currentBlock = this->blocks.size() - 1;
+    this->offset = 0;
+    return Allocate(bytes, alignment);
+}
+
+/**
+ * Makes all of the arena's memory available again. Everything allocated before is no longer valid.
+ */
+void FrameArena::Reset() {
+    this->currentBlock = 0;
+    this->offset = 0;
+}
+
+/**
+ * Returns the number of bytes handed out since the last Reset(), including padding and the unused ends of full blocks.
+ */
+size_t FrameArena::BytesUsed() {
+    size_t used = this->offset;
+    for(int i=0; i<this->currentBlock && i<this->blocks.size(); i++) {
+        used += this->blockSizes[i];
+    }
+
+    return used;
+}
+
+/**
+ * Returns the total number of bytes the arena has taken from the heap.
+ */
+size_t FrameArena::Capacity() {
+    size_t capacity = 0;
+    for(int i=0; i<this->blockSizes.size(); i++) {
+        capacity += this->blockSizes[i];
+    }
+
+    return capacity;
+}
+
+/**
+ * Gives every block back to the heap.
+ */
+void FrameArena::Release() {
+    for(int i=0; i<this->blocks.size(); i++) {
+        delete[] this->blocks[i];
+    }
+
+    this->blocks.clear();
+    this->blockSizes.clear();
+    this->currentBlock = 0;
+    this->offset = 0;
+}
@@ -0,0 +1,85 @@
+#include "Util.h"
+
+/**
+ * Source file for the FrameRing class.
+ * Written By: Brach Knutson
+ */
+
+using namespace cv;
+using namespace KiwiLight;
+
+/**
+ * Creates a new, empty FrameRing.
+ */
+FrameRing::FrameRing() {
+    this->back = 0;
+    this->middle.store(1);
+    this->front = 2;
+    this->acquiredSequence = 0;
+    this->acquiredTimestamp = 0;
+    this->published.store(0);
+    this->dropped.store(0);
+    this->duplicated.store(0);
+
+    for(int i=0; i<SLOTS; i++) {
+        this->sequences[i] = 0;
+        this->timestamps[i] = 0;
+    }
+}
+
+/**
+ * Returns the buffer that the producer should write its next frame into.
+ * The buffer is reused between frames, so writing a frame of the same size and type does not allocate.
+ * Only the producer thread may call this method.
+ */
+cv::Mat &FrameRing::WriteBuffer() {
+    return this->slots[this->back];
+}
+
+/**
+ * Makes the frame in the write buffer the newest frame and gives the producer a new buffer to write into.
+ * This method never blocks. Only the producer thread may call this method.
+ * @param timestamp When the frame was captured, from Clock::GetMonotonicTime().
+ */
+void FrameRing::Publish(long long timestamp) {
+    long sequence = this->published.load(std::memory_order_relaxed) + 1;
+    this->sequences[this->back] = sequence;
+    this->timestamps[this->back] = timestamp;
+    this->published.store(sequence, std::memory_order_relaxed);
+
+    int previous = this->middle.exchange(this->back | FRESH_BIT, std::memory_order_acq_rel);
+    if(previous & FRESH_BIT) {
+        //the consumer never saw the frame we just replaced
+        this->dropped++;
+    }
+
+    this->back = previous & INDEX_MASK;
+}
+
+/**
+ * Returns true if a frame has been published since the consumer last called Acquire(), false otherwise.
+ */
+bool FrameRing::HasNewFrame() {
+    return (this->middle.load(std::memory_order_acquire) & FRESH_BIT) != 0;
+}
+
+/**
+ * Points "frame" at the newest published frame. The frame stays valid until the next call to Acquire().
+ * Only the consumer thread may call this method.
+ * @param frame The Mat that will refer to the newest frame.
+ * @return True if the frame is new since the last call, false if it is the same frame as before.
+ */
+bool FrameRing::Acquire(cv::Mat &frame) {
+    bool fresh = this->HasNewFrame();
+    if(fresh) {
+        int previous = this->middle.exchange(this->front, std::memory_order_acq_rel);
+        this->front = previous & INDEX_MASK;
+        this->acquiredSequence = this->sequences[this->front];
+        this->acquiredTimestamp = this->timestamps[this->front];
+    } else {
+        this->duplicated++;
+    }
+
+    frame = this->slots[this->front];
+    return fresh;
+}
@@ -0,0 +1,98 @@
+#include "Util.h"
+
+/**
+ * Source file for the MessageWriter class.
+ * Written By: Brach Knutson
+ */
+
+//std::to_chars() needs C++17. Older compilers, like the one on Raspbian Stretch, use the loop in Append(long long) instead
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#define KIWILIGHT_HAS_TO_CHARS
+#endif
+#endif
+
+using namespace KiwiLight;
+
+/**
+ * Creates a new MessageWriter.
+ * @param buffer Where to write the message. It must outlive the writer.
+ * @param capacity The number of bytes in "buffer".
+ */
+MessageWriter::MessageWriter(char *buffer, int capacity) {
+    this->buffer = buffer;
+    this->capacity = capacity;
+    this->Clear();
+}
+
+/**
+ * Empties the message so the buffer can be reused.
+ */
+void MessageWriter::Clear() {
+    this->size = 0;
+    this->overflowed = false;
+}
+
+/**
+ * Adds one character to the end of the message.
+ */
+void MessageWriter::Append(char character) {
+    if(this->size >= this->capacity) {
+        this->overflowed = true;
+        return;
+    }
+
+    this->buffer[this->size] = character;
+    this->size++;
+}
+
+/**
+ * Adds a null-terminated string to the end of the message. The terminator is not added.
+ */
+void MessageWriter::Append(const char *text) {
+    for(int i=0; text[i] != '\0'; i++) {
+        this->Append(text[i]);
+    }
+}
+
+/**
+ * Adds "value" to the end of the message in base 10, formatted the same way as std::to_string().
+ */
+void MessageWriter::Append(long long value) {
+    char *end = this->buffer + this->capacity;
+    char *at = this->buffer + this->size;
+
+    #ifdef KIWILIGHT_HAS_TO_CHARS
+        std::to_chars_result result = std::to_chars(at, end, value);
+        if(result.ec != std::errc()) {
+            this->overflowed = true;
+            return;
+        }
+
+        this->size = result.ptr - this->buffer;
+    #else
+        //write the digits backwards into a scratch buffer, then copy them over in order
+        char digits[20];
+        int numberOfDigits = 0;
+        unsigned long long magnitude = (value < 0 ? 0ULL - (unsigned long long) value : (unsigned long long) value);
+        do {
+            digits[numberOfDigits] = (char) ('0' + (magnitude % 10));
+            numberOfDigits++;
+            magnitude /= 10;
+        } while(magnitude > 0);
+
+        if(end - at < numberOfDigits + (value < 0 ? 1 : 0)) {
+            this->overflowed = true;
+            return;
+        }
+
+        if(value < 0) {
+            this->Append('-');
+        }
+
+        for(int i=numberOfDigits - 1; i>=0; i--) {
+            this->Append(digits[i]);
+        }
+    #endif
+}
@@ -0,0 +1,83 @@
+#include "Util.h"
+
+/**
+ * Source file for the ThreadPool class.
+ * Written By: Brach Knutson
+ */
+
+using namespace KiwiLight;
+
+/**
+ * Creates a new ThreadPool and starts its workers.
+ * @param threads The number of worker threads to start.
+ */
+ThreadPool::ThreadPool(int threads) {
+    this->unfinishedTasks = 0;
+    this->stopping = false;
+
+    for(int i=0; i<threads; i++) {
+        this->workers.push_back(std::thread(&ThreadPool::WorkerLoop, this));
+    }
+}
+
+/**
+ * Lets the workers finish the tasks they already have, then stops them.
+ */
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(this->taskLock);
+        this->stopping = true;
+    }
+    this->taskAdded.notify_all();
+
+    for(int i=0; i<this->workers.size(); i++) {
+        this->workers[i].join();
+    }
+}
+
+/**
+ * Queues "task" to be run by the next free worker.
+ */
+void ThreadPool::Submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(this->taskLock);
+        this->tasks.push_back(task);
+        this->unfinishedTasks++;
+    }
+    this->taskAdded.notify_one();
+}
+
+/**
+ * Waits until every submitted task has finished.
+ */
+void ThreadPool::Wait() {
+    std::unique_lock<std::mutex> lock(this->taskLock);
+    this->taskFinished.wait(lock, [this] { return this->unfinishedTasks == 0; });
+}
+
+/**
+ * Runs tasks as they are submitted until the pool is destroyed.
+ */
+void ThreadPool::WorkerLoop() {
+    while(true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(this->taskLock);
+            this->taskAdded.wait(lock, [this] { return this->stopping || !this->tasks.empty(); });
+            if(this->tasks.empty()) {
+                return; //stopping and nothing left to do
+            }
+
+            task = this->tasks.front();
+            this->tasks.pop_front();
+        }
+
+        task();
+
+        {
+            std::lock_guard<std::mutex> lock(this->taskLock);
+            this->unfinishedTasks--;
+        }
+        this->taskFinished.notify_all();
+    }
+}
@@ -129,9 +129,17 @@ bool UDP::AttemptToConnect() {
  * Sends the given message to the destination
  * @param msg a string containing the message to send
  */
-void UDP::Send(std::string msg) {
-    const char *buffer = msg.c_str();
-    int send_result = send(this->sock, buffer, strlen(buffer), 0); //the big send
+void UDP::Send(const std::string &msg) {
+    //binary messages can contain zeros, so the whole string is sent rather than stopping at the first one
+    this->Send(msg.data(), msg.size());
+}
+
+/**
+ * Sends "size" bytes starting at "data" to the destination as one datagram.
+ * Nothing is copied, so "data" can be a buffer on the caller's stack, like the one a MessageWriter fills.
+ */
+void UDP::Send(const char *data, int size) {
+    int send_result = send(this->sock, data, size, 0); //the big send
 }
 
 /**
@@ -0,0 +1,170 @@
+#include "Util.h"
+#include <cerrno>
+#include <cstring>
+
+/**
+ * Source file for the UDPPublisher class.
+ * Written By: Brach Knutson
+ */
+
+using namespace KiwiLight;
+
+//multicast only needs to reach the robot's own network, so it is never routed past the first hop
+const int UDPPublisher::MULTICAST_TTL = 1;
+
+/**
+ * Creates a new UDPPublisher with no destinations.
+ */
+UDPPublisher::UDPPublisher() {
+    this->sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if(this->sock < 0) {
+        std::cout << "WARNING: The UDP publisher could not create a socket." << std::endl;
+    }
+}
+
+/**
+ * Closes the UDP socket.
+ */
+UDPPublisher::~UDPPublisher() {
+    if(this->sock >= 0) {
+        close(this->sock);
+    }
+}
+
+/**
+ * Adds a place to send every message to.
+ * @param address The IPv4 address of the destination. Multicast groups are sent to like any other address.
+ * @param port The port to send to.
+ * @return True if the destination was added, false if "address" is not an IPv4 address.
+ */
+bool UDPPublisher::AddDestination(std::string address, int port) {
+    UDPDestination destination = UDPDestination(address, port);
+    memset(&destination.socketAddress, 0, sizeof(destination.socketAddress));
+    destination.socketAddress.sin_family = AF_INET;
+    destination.socketAddress.sin_port = htons(port);
+    if(inet_pton(AF_INET, address.c_str(), &destination.socketAddress.sin_addr) <= 0) {
+        return false;
+    }
+
+    destination.multicast = IN_MULTICAST(ntohl(destination.socketAddress.sin_addr.s_addr));
+    if(destination.multicast) {
+        unsigned char ttl = MULTICAST_TTL;
+        if(setsockopt(this->sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0) {
+            std::cout << "WARNING: Could not set the multicast TTL for " << address << ": " << strerror(errno) << std::endl;
+        }
+    }
+
+    this->destinations.push_back(destination);
+    this->messages.resize(this->destinations.size());
+    return true;
+}
+
+/**
+ * Sends multicast destinations out of the interface that "address" is reached through, rather than the one
+ * the kernel picks for the group, which is usually the default route and not the robot's network.
+ * @param address The IPv4 address of a unicast destination on the network multicast should go to.
+ * @param port The port of that destination. Nothing is sent to it.
+ * @return True if the interface was set, false if there is no route to "address" or it is not an IPv4 address.
+ */
+bool UDPPublisher::SetMulticastInterfaceFor(std::string address, int port) {
+    sockaddr_in remote;
+    memset(&remote, 0, sizeof(remote));
+    remote.sin_family = AF_INET;
+    remote.sin_port = htons(port);
+    if(inet_pton(AF_INET, address.c_str(), &remote.sin_addr) <= 0) {
+        return false;
+    }
+
+    //connecting a UDP socket sends nothing, but picks the local address the route to "address" uses
+    int probe = socket(AF_INET, SOCK_DGRAM, 0);
+    if(probe < 0) {
+        return false;
+    }
+
+    sockaddr_in local;
+    socklen_t localLength = sizeof(local);
+    bool found = connect(probe, (sockaddr*) &remote, sizeof(remote)) == 0 &&
+                 getsockname(probe, (sockaddr*) &local, &localLength) == 0;
+    close(probe);
+    if(!found) {
+        return false;
+    }
+
+    return setsockopt(this->sock, IPPROTO_IP, IP_MULTICAST_IF, &local.sin_addr, sizeof(local.sin_addr)) == 0;
+}
+
+/**
+ * Removes every destination, along with their counters.
+ */
+void UDPPublisher::ClearDestinations() {
+    this->destinations.clear();
+    this->messages.clear();
+}
+
+/**
+ * Sends "msg" to every destination.
+ */
+void UDPPublisher::Publish(const std::string &msg) {
+    this->Publish(msg.data(), msg.size());
+}
+
+/**
+ * Sends "size" bytes starting at "data" to every destination as one datagram each, in a single sendmmsg() call.
+ * Never blocks; a message that can't be sent right away counts as an error for its destination.
+ */
+void UDPPublisher::Publish(const char *data, int size) {
+    //the headers are filled in every time, since the destinations vector may have moved since the last message
+    iovec payload;
+    payload.iov_base = (void*) data;
+    payload.iov_len = size;
+
+    int numberOfMessages = this->messages.size();
+    for(int i=0; i<numberOfMessages; i++) {
+        mmsghdr &message = this->messages[i];
+        memset(&message, 0, sizeof(message));
+        message.msg_hdr.msg_name = &this->destinations[i].socketAddress;
+        message.msg_hdr.msg_namelen = sizeof(this->destinations[i].socketAddress);
+        message.msg_hdr.msg_iov = &payload;
+        message.msg_hdr.msg_iovlen = 1;
+    }
+
+    //sendmmsg() stops at the first message that fails and returns how many went before it.
+    //that one fails again straight away on the next call, which is how its error is found
+    int next = 0;
+    while(next < numberOfMessages) {
+        int sent = sendmmsg(this->sock, &this->messages[next], numberOfMessages - next, MSG_DONTWAIT);
+        if(sent > 0) {
+            for(int i=next; i<next + sent; i++) {
+                this->destinations[i].sent++;
+            }
+            next += sent;
+        } else {
+            UDPDestination &failed = this->destinations[next];
+            failed.errors++;
+            failed.lastError = errno;
+            next++;
+        }
+    }
+}
+
+/**
+ * Returns a line for each destination saying how many messages were sent to it and how many failed.
+ */
+std::string UDPPublisher::Summary() {
+    std::string summary = "";
+    for(int i=0; i<this->destinations.size(); i++) {
+        UDPDestination destination = this->destinations[i];
+        summary += destination.address + ":" + std::to_string(destination.port) + (destination.multicast ? " (multicast)" : "") + ": " 
+                 + std::to_string(destination.sent) + " sent, " + std::to_string(destination.errors) + " failed";
+
+        if(destination.lastError != 0) {
+            summary += " (last error: " + std::string(strerror(destination.lastError)) + ")";
+        }
+
+        if(i < this->destinations.size() - 1) {
+            summary += "\n";
+        }
+    }
+
+    return summary;
+}
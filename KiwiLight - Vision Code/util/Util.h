@@ -6,6 +6,16 @@
 #include <fstream>
 #include <chrono>
 #include <ctime>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include <memory>
+#include <deque>
+#include <vector>
+#include <cstdint>
+#include <cerrno>
 #include "opencv2/opencv.hpp"
 #include "netdb.h"
 #include "unistd.h"
@@ -90,6 +100,29 @@ namespace KiwiLight {
     };
 
 
+    /**
+     * Formats a message into a buffer owned by the caller, usually an array on the stack, without allocating.
+     * Anything that does not fit is dropped and Overflowed() becomes true; the buffer is never written past its end.
+     */
+    class MessageWriter {
+        public:
+        MessageWriter(char *buffer, int capacity);
+        void Clear();
+        void Append(char character);
+        void Append(const char *text);
+        void Append(long long value);
+        void Append(int value) { this->Append((long long) value); };
+        const char *Data() const { return this->buffer; };
+        int Size() const { return this->size; };
+        bool Overflowed() const { return this->overflowed; };
+
+        private:
+        char *buffer;
+        int capacity,
+            size;
+        bool overflowed;
+    };
+
     /**
      * A UDP sender utility that sends and recieves information to and from the RIO.
      */
@@ -99,7 +132,8 @@ namespace KiwiLight {
         UDP(std::string dest_ip, int port, bool blockUntilConnected);
         bool AttemptToConnect();
         bool Connected() { return this->connected; };
-        void Send(std::string msg);
+        void Send(const std::string &msg);
+        void Send(const char *data, int size);
         std::string Recieve();
         void Close();
         std::string GetAddress() { return this->address; };
@@ -120,6 +154,51 @@ namespace KiwiLight {
         int port;
     };
 
+    /**
+     * One place a UDPPublisher sends to, and how sending to it has gone.
+     */
+    struct UDPDestination {
+        UDPDestination() : port(0), multicast(false), sent(0), errors(0), lastError(0) {};
+        UDPDestination(std::string address, int port) : address(address), port(port), multicast(false), sent(0), errors(0), lastError(0) {};
+
+        std::string address;
+        int port;
+        bool multicast;      //true if the address is an IPv4 multicast group
+        long sent,           //messages handed to the network
+             errors;         //messages that could not be sent
+        int lastError;       //errno of the last failed send, or 0
+        sockaddr_in socketAddress;
+    };
+
+    /**
+     * Sends each message to any number of unicast and multicast destinations with one sendmmsg() call,
+     * keeping count of what was sent and what failed for each one. The socket is not connected, so one 
+     * unreachable destination does not stop the others from getting the message.
+     * A publisher owns its socket and can't be copied; share it with a std::shared_ptr instead.
+     */
+    class UDPPublisher {
+        public:
+        static const int MULTICAST_TTL;
+
+        UDPPublisher();
+        UDPPublisher(const UDPPublisher&) = delete;
+        UDPPublisher &operator=(const UDPPublisher&) = delete;
+        ~UDPPublisher();
+        bool AddDestination(std::string address, int port);
+        bool SetMulticastInterfaceFor(std::string address, int port);
+        void ClearDestinations();
+        int NumberOfDestinations() { return this->destinations.size(); };
+        UDPDestination GetDestination(int index) { return this->destinations[index]; };
+        void Publish(const std::string &msg);
+        void Publish(const char *data, int size);
+        std::string Summary();
+
+        private:
+        int sock; //sock fd returned by socket() call
+        std::vector<UDPDestination> destinations;
+        std::vector<mmsghdr> messages; //one per destination, so that publishing does not allocate
+    };
+
     /**
      * An attribute of an XML Tag.
      * ex: <tag attribute="">
@@ -252,12 +331,256 @@ namespace KiwiLight {
         void Start();
         long GetTime();
         static long GetSystemTime();
+        static long long GetMonotonicTime();
         static std::string GetDateString();
 
         private:
         long startTime;
     };
 
+    /**
+     * A lock-free ring of preallocated image buffers shared by exactly one producer thread and one consumer thread.
+     * The producer fills its back buffer and publishes it, and the consumer always receives the newest published frame.
+     * Frames that are overwritten before the consumer sees them are counted as dropped, and requests that find no new
+     * frame are counted as duplicated.
+     */
+    class FrameRing {
+        public:
+        static const int SLOTS = 3;
+
+        FrameRing();
+        cv::Mat &WriteBuffer();
+        void Publish(long long timestamp);
+        bool HasNewFrame();
+        bool Acquire(cv::Mat &frame);
+        long Sequence() { return this->acquiredSequence; };
+        long long Timestamp() { return this->acquiredTimestamp; };
+        long FramesPublished() { return this->published.load(); };
+        long FramesDropped() { return this->dropped.load(); };
+        long FramesDuplicated() { return this->duplicated.load(); };
+
+        private:
+        static const int INDEX_MASK = 0x3;
+        static const int FRESH_BIT  = 0x4;
+
+        cv::Mat slots[SLOTS];
+        long sequences[SLOTS];
+        long long timestamps[SLOTS];
+
+        //index of the published slot, with FRESH_BIT set if the consumer has not taken it yet
+        std::atomic<int> middle;
+
+        int back,  //owned by the producer
+            front; //owned by the consumer
+
+        long acquiredSequence;
+        long long acquiredTimestamp;
+
+        std::atomic<long>
+            published,
+            dropped,
+            duplicated;
+    };
+
+    /**
+     * A bounded first-in-first-out queue for handing items from exactly one producer thread to exactly one consumer thread.
+     * Pushing and popping do not lock each other out; the mutex is only used to sleep while the queue is full or empty.
+     */
+    template<typename T>
+    class SPSCQueue {
+        public:
+        SPSCQueue(int capacity) 
+         : items(capacity + 1) {
+            this->head.store(0);
+            this->tail.store(0);
+            this->closed.store(false);
+        }
+
+        /**
+         * Adds "item" to the back of the queue, waiting while the queue is full.
+         * @return True if the item was added, false if the queue was closed.
+         */
+        bool Push(T item) {
+            size_t tail = this->tail.load(std::memory_order_relaxed);
+            size_t next = (tail + 1) % this->items.size();
+
+            {
+                std::unique_lock<std::mutex> lock(this->waitLock);
+                this->changed.wait(lock, [&] {
+                    return next != this->head.load(std::memory_order_acquire) || this->closed.load();
+                });
+            }
+
+            if(this->closed.load()) {
+                return false;
+            }
+
+            this->items[tail] = std::move(item);
+            this->tail.store(next, std::memory_order_release);
+            Notify();
+            return true;
+        }
+
+        /**
+         * Removes the item at the front of the queue and stores it in "item", waiting while the queue is empty.
+         * @return True if an item was removed, false if the queue was closed.
+         */
+        bool Pop(T &item) {
+            size_t head = this->head.load(std::memory_order_relaxed);
+
+            {
+                std::unique_lock<std::mutex> lock(this->waitLock);
+                this->changed.wait(lock, [&] {
+                    return head != this->tail.load(std::memory_order_acquire) || this->closed.load();
+                });
+            }
+
+            if(head == this->tail.load(std::memory_order_acquire)) {
+                return false;
+            }
+
+            item = std::move(this->items[head]);
+            this->head.store((head + 1) % this->items.size(), std::memory_order_release);
+            Notify();
+            return true;
+        }
+
+        /**
+         * Wakes up and refuses all waiting and future Push() and Pop() calls.
+         */
+        void Close() {
+            this->closed.store(true);
+            Notify();
+        }
+
+        /**
+         * Returns the number of items currently in the queue.
+         */
+        int Size() {
+            size_t head = this->head.load(std::memory_order_acquire);
+            size_t tail = this->tail.load(std::memory_order_acquire);
+            return (int) ((tail + this->items.size() - head) % this->items.size());
+        }
+
+        int Capacity() { return (int) this->items.size() - 1; };
+
+        private:
+        void Notify() {
+            //briefly take the lock so the other side can't miss the wakeup between checking and waiting
+            { std::lock_guard<std::mutex> lock(this->waitLock); }
+            this->changed.notify_all();
+        }
+
+        std::vector<T> items;
+        std::atomic<size_t> 
+            head,
+            tail;
+        std::atomic<bool> closed;
+        std::mutex waitLock;
+        std::condition_variable changed;
+    };
+
+    /**
+     * A fixed number of worker threads that run submitted tasks.
+     */
+    class ThreadPool {
+        public:
+        ThreadPool(int threads);
+        ~ThreadPool();
+        void Submit(std::function<void()> task);
+        void Wait();
+        int Size() { return this->workers.size(); };
+
+        private:
+        void WorkerLoop();
+
+        std::vector<std::thread> workers;
+        std::deque< std::function<void()> > tasks;
+        std::mutex taskLock;
+        std::condition_variable
+            taskAdded,
+            taskFinished;
+        int unfinishedTasks;
+        bool stopping;
+    };
+
+    /**
+     * A monotonic memory arena for data that only lives for one frame. Allocation just moves a pointer forward,
+     * nothing is freed individually, and Reset() makes all of the memory available again. Blocks are kept between
+     * resets, so once the arena has grown to fit a frame it never asks the heap for memory again.
+     */
+    class FrameArena {
+        public:
+        static const size_t DEFAULT_BLOCK_SIZE;
+
+        FrameArena();
+        FrameArena(size_t blockSize);
+        FrameArena(const FrameArena &other);
+        FrameArena &operator=(const FrameArena &other);
+        ~FrameArena();
+        void *Allocate(size_t bytes, size_t alignment);
+        void Reset();
+        size_t BytesUsed();
+        size_t Capacity();
+
+        private:
+        void Release();
+
+        std::vector<char*> blocks;
+        std::vector<size_t> blockSizes;
+        size_t blockSize,
+               currentBlock, //index of the block being allocated from
+               offset;       //bytes used in the current block
+    };
+
+    /**
+     * A standard library allocator that takes its memory from a FrameArena, so that containers can be 
+     * built each frame without touching the heap. Memory is given back when the arena is reset, not when 
+     * the container is destroyed, so containers must not outlive the arena's next reset.
+     */
+    template<typename T>
+    class ArenaAllocator {
+        public:
+        typedef T value_type;
+
+        ArenaAllocator(FrameArena *arena) 
+         : arena(arena) {
+        }
+
+        template<typename U>
+        ArenaAllocator(const ArenaAllocator<U> &other) 
+         : arena(other.arena) {
+        }
+
+        T *allocate(size_t count) {
+            return (T*) this->arena->Allocate(count * sizeof(T), alignof(T));
+        }
+
+        void deallocate(T *pointer, size_t count) {
+        }
+
+        template<typename U>
+        bool operator==(const ArenaAllocator<U> &other) const { return this->arena == other.arena; };
+
+        template<typename U>
+        bool operator!=(const ArenaAllocator<U> &other) const { return this->arena != other.arena; };
+
+        FrameArena *arena;
+    };
+
+    template<typename T>
+    using ArenaVector = std::vector< T, ArenaAllocator<T> >;
+
+    /**
+     * Counts heap allocations made with operator new on each thread. Counting is only compiled in when
+     * KIWILIGHT_COUNT_ALLOCATIONS is defined (see the Makefile's DEBUG variable), otherwise Count() is always 0.
+     */
+    class AllocationCounter {
+        public:
+        static bool Enabled();
+        static long long Count();
+    };
+
     /**
      * Logger Event, such as a general update, or a record time or distance.
      */